@@ -0,0 +1,498 @@
+/*!
+@author ThatOSDev
+@NOTE
+#define ASSETS_IMPLEMENTATION
+#include "assets.h"
+
+Loads textures and shaders in the background while the render loop keeps going. Needs bmp.h,
+shader.h, texture.h and glstate.h with their implementations somewhere in the program.
+
+Two threads do the work. The decode thread reads the files, BMPs go through LoadBMP and shaders
+are read as text. The upload thread has its own GL context, shared with the render one (a hidden
+GLFW window, as in GLFW's examples/sharing.c, or a second EGL context with USE_HEADLESS), makes
+the texture or program there and puts a fence behind it. UpdateAssetStreamer polls those fences
+on the render thread without waiting, an asset is only handed out once its fence has signaled.
+
+EXAMPLE :
+    AssetStreamer assets;
+    StartAssetStreamer(&assets, window);
+    int stone = RequestTexture(&assets, "stone.bmp");
+    while(...)
+    {
+        UpdateAssetStreamer(&assets);
+        const Texture* texture = GetAssetTexture(&assets, stone);
+        if(texture){StateBindTexture(0, GL_TEXTURE_2D, texture->id);}
+        // draw
+    }
+    StopAssetStreamer(&assets);
+*/
+
+#ifndef ASSETS_H
+#define ASSETS_H
+
+#include <glad/gl.h>
+#include <GLFW/glfw3.h>
+#include "texture.h"
+#include "thread.h"
+#ifdef USE_HEADLESS
+#include "headless.h"
+#endif
+
+#ifndef ASSETS_MAX
+#define ASSETS_MAX 256
+#endif
+#define ASSET_PATH_MAX 256
+
+typedef enum AssetType
+{
+    ASSET_TEXTURE = 0,
+    ASSET_SHADER
+} AssetType;
+
+typedef enum AssetState
+{
+    ASSET_QUEUED = 0,  // Waiting for the decode thread.
+    ASSET_DECODED,     // In memory, waiting for the upload thread.
+    ASSET_UPLOADED,    // Made on the upload context, waiting on the fence.
+    ASSET_READY,
+    ASSET_FAILED
+} AssetState;
+
+typedef struct Asset
+{
+    AssetType type;
+    AssetState state;
+    char path[ASSET_PATH_MAX];
+    char fragmentPath[ASSET_PATH_MAX];
+    unsigned char* pixels;
+    int width;
+    int height;
+    unsigned short bitDepth;
+    char* vertexSource;
+    char* fragmentSource;
+    Texture texture;
+    unsigned int program;
+    GLsync fence;
+} Asset;
+
+typedef struct AssetStreamer
+{
+    Asset assets[ASSETS_MAX];
+    int count;
+    int quit;
+    int active;
+    Thread decoder;
+    Thread uploader;
+    Mutex lock;
+    CondVar decodeWake;
+    CondVar uploadWake;
+    GLFWwindow* uploadWindow;
+#ifdef USE_HEADLESS
+    Headless* headless;
+    EGLContext uploadContext;
+#endif
+} AssetStreamer;
+
+/*! @breif
+    This starts the decode and upload threads. Call it on the main thread, the upload context is
+    a hidden window that shares with the given one.
+	@param[out] The streamer.
+	@param[in] The window whose context the assets are used in.
+	@return 1 on success, 0 otherwise.
+*/
+int StartAssetStreamer(AssetStreamer* streamer, GLFWwindow* window);
+
+#ifdef USE_HEADLESS
+/*! @breif
+    This starts the decode and upload threads, uploading through a context shared with the headless one.
+	@param[out] The streamer.
+	@param[in] The headless context, it must outlive the streamer.
+	@return 1 on success, 0 otherwise.
+*/
+int StartAssetStreamerHeadless(AssetStreamer* streamer, Headless* headless);
+#endif
+
+/*! @breif
+    This queues a 24 or 32 Bit BMP to be loaded as a texture.
+	@param[in] The streamer.
+	@param[in] This is the path and name of the file to load.
+	@return The handle of the asset, -1 when it could not be queued.
+*/
+int RequestTexture(AssetStreamer* streamer, const char* fileName);
+
+/*! @breif
+    This queues a vertex and fragment shader to be loaded and linked as a program.
+	@param[in] The streamer.
+	@param[in] The path of the vertex shader.
+	@param[in] The path of the fragment shader.
+	@return The handle of the asset, -1 when it could not be queued.
+*/
+int RequestShader(AssetStreamer* streamer, const char* vertexPath, const char* fragmentPath);
+
+/*! @breif
+    This hands finished uploads to the render thread. Call it once a frame, it never waits.
+	@param[in] The streamer.
+*/
+void UpdateAssetStreamer(AssetStreamer* streamer);
+
+/*! @breif
+    This tells where an asset is.
+	@return 1 when ready, 0 while still loading, -1 when it failed.
+*/
+int AssetReady(AssetStreamer* streamer, int handle);
+
+// NULL / 0 until the asset is ready.
+const Texture* GetAssetTexture(AssetStreamer* streamer, int handle);
+unsigned int   GetAssetProgram(AssetStreamer* streamer, int handle);
+
+/*! @breif
+    This stops the threads, then deletes every asset and the upload context. Call it on the render thread.
+	@param[in] The streamer.
+*/
+void StopAssetStreamer(AssetStreamer* streamer);
+
+#endif // ASSETS_H
+
+#if defined(ASSETS_IMPLEMENTATION) && !defined(ASSETS_IMPLEMENTATION_DONE)
+#define ASSETS_IMPLEMENTATION_DONE
+
+#include <stdlib.h>  // free()
+#include <string.h>  // memset()  strncpy()
+#include "bmp.h"
+#include "shader.h"
+#include "glstate.h"
+#include "logging.h"
+#include "profiler.h"
+
+static int assetsDecodeThread(void* arg)
+{
+    AssetStreamer* streamer = (AssetStreamer*)arg;
+    PROFILE_THREAD("asset decode");
+
+    MutexLock(&streamer->lock);
+    for(;;)
+    {
+        Asset* asset = NULL;
+        while(!streamer->quit)
+        {
+            for(int i = 0; i < streamer->count && asset == NULL; i++)
+            {
+                if(streamer->assets[i].state == ASSET_QUEUED){asset = &streamer->assets[i];}
+            }
+            if(asset){break;}
+            CondWait(&streamer->decodeWake, &streamer->lock);
+        }
+        if(asset == NULL){break;}
+        MutexUnlock(&streamer->lock);
+
+        // Only this thread touches the data of an ASSET_QUEUED asset, so it is safe to work on unlocked.
+        int ok = 0;
+        PROFILE_BEGIN("DecodeAsset");
+        if(asset->type == ASSET_TEXTURE)
+        {
+            asset->pixels = LoadBMP(asset->path, &asset->width, &asset->height, &asset->bitDepth);
+            ok = (asset->pixels != NULL);
+            if(!ok){logError(BMP, "Unable to stream %s", asset->path);}
+        } else {
+            asset->vertexSource = readShaderFile(asset->path);
+            asset->fragmentSource = readShaderFile(asset->fragmentPath);
+            ok = (asset->vertexSource != NULL && asset->fragmentSource != NULL);
+        }
+        PROFILE_END("DecodeAsset");
+
+        MutexLock(&streamer->lock);
+        // After a quit nothing would upload it, see assetsUploadThread.
+        if(streamer->quit){ok = 0;}
+        asset->state = ok ? ASSET_DECODED : ASSET_FAILED;
+        if(ok){CondSignal(&streamer->uploadWake);}
+    }
+    MutexUnlock(&streamer->lock);
+    return 0;
+}
+
+static int assetsMakeCurrent(AssetStreamer* streamer, int current)
+{
+#ifdef USE_HEADLESS
+    if(streamer->headless)
+    {
+        return MakeHeadlessContextCurrent(streamer->headless, current ? streamer->uploadContext : EGL_NO_CONTEXT);
+    }
+#endif
+    glfwMakeContextCurrent(current ? streamer->uploadWindow : NULL);
+    return 1;
+}
+
+// Makes the texture or program on the upload context. The shader.h caches are not thread safe,
+// so programs are linked with compileProgram directly and their uniforms cached on the render thread.
+static int assetsUpload(Asset* asset)
+{
+    int ok = 0;
+    if(asset->type == ASSET_TEXTURE)
+    {
+        ok = CreateTexture(&asset->texture, asset->pixels, asset->width, asset->height, asset->bitDepth);
+        free(asset->pixels);
+        asset->pixels = NULL;
+    } else {
+        asset->program = compileProgram(asset->vertexSource, asset->fragmentSource, asset->path, asset->fragmentPath, 0);
+        GLint success = 0;
+        glGetProgramiv(asset->program, GL_LINK_STATUS, &success);
+        ok = success;
+        if(!ok)
+        {
+            glDeleteProgram(asset->program);
+            asset->program = 0;
+        }
+        free(asset->vertexSource);
+        free(asset->fragmentSource);
+        asset->vertexSource = NULL;
+        asset->fragmentSource = NULL;
+    }
+    if(ok)
+    {
+        // The flush makes sure the fence reaches the GPU, the render thread only polls it.
+        asset->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        glFlush();
+    }
+    return ok;
+}
+
+static int assetsUploadThread(void* arg)
+{
+    AssetStreamer* streamer = (AssetStreamer*)arg;
+    PROFILE_THREAD("asset upload");
+    if(!assetsMakeCurrent(streamer, 1))
+    {
+        // Without the context nothing can be uploaded, so fail what is waiting and take no more.
+        logError(GL, "Unable to make the asset upload context current, asset streaming is off");
+        MutexLock(&streamer->lock);
+        streamer->quit = 1;
+        for(int i = 0; i < streamer->count; i++)
+        {
+            AssetState state = streamer->assets[i].state;
+            if(state == ASSET_QUEUED || state == ASSET_DECODED){streamer->assets[i].state = ASSET_FAILED;}
+        }
+        CondBroadcast(&streamer->decodeWake);
+        MutexUnlock(&streamer->lock);
+        return 0;
+    }
+
+    MutexLock(&streamer->lock);
+    for(;;)
+    {
+        Asset* asset = NULL;
+        while(!streamer->quit)
+        {
+            for(int i = 0; i < streamer->count && asset == NULL; i++)
+            {
+                if(streamer->assets[i].state == ASSET_DECODED){asset = &streamer->assets[i];}
+            }
+            if(asset){break;}
+            CondWait(&streamer->uploadWake, &streamer->lock);
+        }
+        if(asset == NULL){break;}
+        MutexUnlock(&streamer->lock);
+
+        PROFILE_BEGIN("UploadAsset");
+        int ok = assetsUpload(asset);
+        PROFILE_END("UploadAsset");
+
+        MutexLock(&streamer->lock);
+        asset->state = ok ? ASSET_UPLOADED : ASSET_FAILED;
+    }
+    MutexUnlock(&streamer->lock);
+
+    FreeTextureStaging();
+    glFinish();
+    assetsMakeCurrent(streamer, 0);
+    return 0;
+}
+
+static int assetsStartThreads(AssetStreamer* streamer)
+{
+    MutexInit(&streamer->lock);
+    CondInit(&streamer->decodeWake);
+    CondInit(&streamer->uploadWake);
+    if(!ThreadStart(&streamer->decoder, assetsDecodeThread, streamer))
+    {
+        logError(GL, "Unable to start the asset decode thread");
+        CondDestroy(&streamer->uploadWake);
+        CondDestroy(&streamer->decodeWake);
+        MutexDestroy(&streamer->lock);
+        return 0;
+    }
+    if(!ThreadStart(&streamer->uploader, assetsUploadThread, streamer))
+    {
+        logError(GL, "Unable to start the asset upload thread");
+        MutexLock(&streamer->lock);
+        streamer->quit = 1;
+        CondSignal(&streamer->decodeWake);
+        MutexUnlock(&streamer->lock);
+        ThreadJoin(&streamer->decoder);
+        CondDestroy(&streamer->uploadWake);
+        CondDestroy(&streamer->decodeWake);
+        MutexDestroy(&streamer->lock);
+        return 0;
+    }
+    streamer->active = 1;
+    return 1;
+}
+
+int StartAssetStreamer(AssetStreamer* streamer, GLFWwindow* window)
+{
+    memset(streamer, 0, sizeof(AssetStreamer));
+
+    // The context hints of the main window still apply, so both contexts match.
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    streamer->uploadWindow = glfwCreateWindow(1, 1, "Asset upload", NULL, window);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+    if(streamer->uploadWindow == NULL)
+    {
+        logError(WINDOW, "Unable to create the shared asset upload context");
+        return 0;
+    }
+    if(!assetsStartThreads(streamer))
+    {
+        glfwDestroyWindow(streamer->uploadWindow);
+        streamer->uploadWindow = NULL;
+        return 0;
+    }
+    return 1;
+}
+
+#ifdef USE_HEADLESS
+int StartAssetStreamerHeadless(AssetStreamer* streamer, Headless* headless)
+{
+    memset(streamer, 0, sizeof(AssetStreamer));
+    streamer->headless = headless;
+    streamer->uploadContext = CreateHeadlessSharedContext(headless);
+    if(streamer->uploadContext == EGL_NO_CONTEXT){return 0;}
+    if(!assetsStartThreads(streamer))
+    {
+        DestroyHeadlessSharedContext(headless, streamer->uploadContext);
+        streamer->uploadContext = EGL_NO_CONTEXT;
+        return 0;
+    }
+    return 1;
+}
+#endif
+
+static int assetsRequest(AssetStreamer* streamer, AssetType type, const char* path, const char* fragmentPath)
+{
+    if(!streamer->active){return -1;}
+    MutexLock(&streamer->lock);
+    if(streamer->quit)
+    {
+        MutexUnlock(&streamer->lock);
+        logError(GL, "Asset streaming has stopped, %s was not queued", path);
+        return -1;
+    }
+    if(streamer->count >= ASSETS_MAX)
+    {
+        MutexUnlock(&streamer->lock);
+        logError(GL, "Too many assets (%d), %s was not queued", ASSETS_MAX, path);
+        return -1;
+    }
+    int handle = streamer->count;
+    Asset* asset = &streamer->assets[handle];
+    memset(asset, 0, sizeof(Asset));
+    asset->type = type;
+    asset->state = ASSET_QUEUED;
+    strncpy(asset->path, path, ASSET_PATH_MAX - 1);
+    if(fragmentPath){strncpy(asset->fragmentPath, fragmentPath, ASSET_PATH_MAX - 1);}
+    streamer->count++;
+    CondSignal(&streamer->decodeWake);
+    MutexUnlock(&streamer->lock);
+    return handle;
+}
+
+int RequestTexture(AssetStreamer* streamer, const char* fileName)
+{
+    return assetsRequest(streamer, ASSET_TEXTURE, fileName, NULL);
+}
+
+int RequestShader(AssetStreamer* streamer, const char* vertexPath, const char* fragmentPath)
+{
+    return assetsRequest(streamer, ASSET_SHADER, vertexPath, fragmentPath);
+}
+
+void UpdateAssetStreamer(AssetStreamer* streamer)
+{
+    if(!streamer->active){return;}
+    PROFILE_BEGIN("UpdateAssetStreamer");
+    MutexLock(&streamer->lock);
+    for(int i = 0; i < streamer->count; i++)
+    {
+        Asset* asset = &streamer->assets[i];
+        if(asset->state != ASSET_UPLOADED){continue;}
+
+        GLenum result = glClientWaitSync(asset->fence, 0, 0);
+        if(result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED){continue;}
+        glDeleteSync(asset->fence);
+        asset->fence = NULL;
+        if(asset->type == ASSET_SHADER){cacheUniformLocations(asset->program);}
+        asset->state = ASSET_READY;
+    }
+    MutexUnlock(&streamer->lock);
+    PROFILE_END("UpdateAssetStreamer");
+}
+
+int AssetReady(AssetStreamer* streamer, int handle)
+{
+    if(handle < 0 || handle >= streamer->count){return -1;}
+    MutexLock(&streamer->lock);
+    AssetState state = streamer->assets[handle].state;
+    MutexUnlock(&streamer->lock);
+    if(state == ASSET_READY){return 1;}
+    return (state == ASSET_FAILED) ? -1 : 0;
+}
+
+const Texture* GetAssetTexture(AssetStreamer* streamer, int handle)
+{
+    if(AssetReady(streamer, handle) != 1 || streamer->assets[handle].type != ASSET_TEXTURE){return NULL;}
+    return &streamer->assets[handle].texture;
+}
+
+unsigned int GetAssetProgram(AssetStreamer* streamer, int handle)
+{
+    if(AssetReady(streamer, handle) != 1 || streamer->assets[handle].type != ASSET_SHADER){return 0;}
+    return streamer->assets[handle].program;
+}
+
+void StopAssetStreamer(AssetStreamer* streamer)
+{
+    if(!streamer->active){return;}
+
+    MutexLock(&streamer->lock);
+    streamer->quit = 1;
+    CondBroadcast(&streamer->decodeWake);
+    CondBroadcast(&streamer->uploadWake);
+    MutexUnlock(&streamer->lock);
+    ThreadJoin(&streamer->decoder);
+    ThreadJoin(&streamer->uploader);
+
+    // The upload thread finished its context before it let go, so everything here is complete.
+    for(int i = 0; i < streamer->count; i++)
+    {
+        Asset* asset = &streamer->assets[i];
+        if(asset->fence){glDeleteSync(asset->fence);}
+        if(asset->texture.id){DestroyTexture(&asset->texture);}
+        if(asset->program){ShaderCleanUp(asset->program);}
+        free(asset->pixels);
+        free(asset->vertexSource);
+        free(asset->fragmentSource);
+    }
+
+#ifdef USE_HEADLESS
+    if(streamer->headless)
+    {
+        DestroyHeadlessSharedContext(streamer->headless, streamer->uploadContext);
+    }
+#endif
+    if(streamer->uploadWindow){glfwDestroyWindow(streamer->uploadWindow);}
+    CondDestroy(&streamer->uploadWake);
+    CondDestroy(&streamer->decodeWake);
+    MutexDestroy(&streamer->lock);
+    streamer->active = 0;
+}
+
+#endif // ASSETS_IMPLEMENTATION
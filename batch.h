@@ -0,0 +1,358 @@
+/*!
+@author ThatOSDev
+@NOTE
+#define BATCH_IMPLEMENTATION
+#include "batch.h"
+
+Packs many meshes into one vertex buffer and one index buffer behind a single VAO, so drawing
+any number of them needs no VAO switches. Draws are recorded as DrawElementsIndirectCommand
+entries, grouped by material and submitted with one glMultiDrawElementsIndirect per material.
+
+Without GL 4.3 / ARB_multi_draw_indirect (or with BATCH_NO_INDIRECT) it falls back to one
+glMultiDrawElementsBaseVertex per material. baseInstance needs the indirect path. On the
+fallback, draws with instanceCount 1 are still one call and the rest are drawn one at a time.
+
+baseInstance picks per-draw data from any attribute with a divisor, e.g. attach an instance.h
+InstanceBatch to batch.vao and use the draw's index in it as baseInstance.
+
+EXAMPLE :
+    DrawBatch batch;
+    CreateDrawBatch(&batch, GL_TRIANGLES, sizeof(Vertex), 65536, 65536, 4096);
+    StateBindVertexArray(batch.vao);               // Vertex layout, once.
+    StateBindBuffer(GL_ARRAY_BUFFER, batch.vertexBuffer);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+    glEnableVertexAttribArray(0);
+    int cube = AddBatchMesh(&batch, cubeVertices, 24, cubeIndices, 36);
+    while(...)
+    {
+        ClearBatchDraws(&batch);
+        AddBatchDraw(&batch, stoneMaterial, cube, 1, 0);
+        SubmitDrawBatch(&batch);                   // Sorts by material and uploads the commands.
+        StateUseProgram(stoneProgram);
+        DrawBatchMaterial(&batch, stoneMaterial);
+    }
+    DestroyDrawBatch(&batch);
+*/
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <glad/gl.h>
+#include <stddef.h>  // size_t
+
+#ifndef BATCH_MAX_MATERIALS
+#define BATCH_MAX_MATERIALS 64
+#endif
+
+// The layout glMultiDrawElementsIndirect reads, do not reorder.
+typedef struct DrawElementsIndirectCommand
+{
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint  baseVertex;
+    GLuint baseInstance;
+} DrawElementsIndirectCommand;
+
+typedef struct BatchMesh
+{
+    GLuint firstIndex;
+    GLuint indexCount;
+    GLint  baseVertex;
+} BatchMesh;
+
+typedef struct DrawBatch
+{
+    GLuint vao;
+    GLuint vertexBuffer;
+    GLuint indexBuffer;                    // GL_UNSIGNED_INT indices.
+    GLuint commandBuffer;                  // GL_DRAW_INDIRECT_BUFFER, indirect path only.
+    GLenum mode;
+    int indirect;
+    size_t vertexStride;
+    int vertexCount, vertexCapacity;
+    int indexCount, indexCapacity;
+    BatchMesh* meshes;
+    int meshCount, meshCapacity;
+    DrawElementsIndirectCommand* draws;    // As recorded.
+    int* drawMaterials;
+    DrawElementsIndirectCommand* commands; // Sorted by material by SubmitDrawBatch.
+    int drawCount, drawCapacity;
+    int materialStart[BATCH_MAX_MATERIALS + 1];
+    GLsizei* fallbackCounts;               // glMultiDrawElementsBaseVertex arguments.
+    void** fallbackOffsets;
+    GLint* fallbackBaseVertex;
+} DrawBatch;
+
+/*! @breif
+    This creates the shared buffers and the VAO. Set up the vertex attributes on batch->vao afterwards.
+	@param[out] The batch.
+	@param[in] The primitive, e.g. GL_TRIANGLES.
+	@param[in] The size of one vertex in bytes.
+	@param[in] The most vertices of all meshes together.
+	@param[in] The most indices of all meshes together.
+	@param[in] The most draws recorded in one frame.
+	@return 1 on success, 0 otherwise.
+*/
+int  CreateDrawBatch(DrawBatch* batch, GLenum mode, size_t vertexStride, int maxVertices, int maxIndices, int maxDraws);
+
+/*! @breif
+    This copies a mesh into the shared buffers. Indices are relative to the mesh's own vertices.
+	@return The mesh id for AddBatchDraw, -1 when the batch is full.
+*/
+int  AddBatchMesh(DrawBatch* batch, const void* vertices, int vertexCount, const GLuint* indices, int indexCount);
+
+/*! @breif
+    This records one draw for this frame.
+	@param[in] The batch.
+	@param[in] The material, 0 to BATCH_MAX_MATERIALS - 1. Draws are grouped by it.
+	@param[in] The mesh id from AddBatchMesh.
+	@param[in] The number of instances, usually 1.
+	@param[in] The first instance, for attributes with a divisor.
+	@return 1 on success, 0 otherwise.
+*/
+int  AddBatchDraw(DrawBatch* batch, int material, int mesh, GLuint instanceCount, GLuint baseInstance);
+void ClearBatchDraws(DrawBatch* batch);
+
+/*! @breif
+    This sorts the recorded draws by material and uploads them. Call once per frame before drawing.
+	@param[in] The batch.
+*/
+void SubmitDrawBatch(DrawBatch* batch);
+
+/*! @breif
+    This draws everything recorded with a material, in one call. Bind the material's program first.
+	@param[in] The batch.
+	@param[in] The material.
+*/
+void DrawBatchMaterial(DrawBatch* batch, int material);
+void DestroyDrawBatch(DrawBatch* batch);
+
+#endif // BATCH_H
+
+#if defined(BATCH_IMPLEMENTATION) && !defined(BATCH_IMPLEMENTATION_DONE)
+#define BATCH_IMPLEMENTATION_DONE
+
+#include <stdlib.h>  // malloc()  realloc()  free()
+#include <string.h>  // memcpy()  memset()
+#include "profiler.h"
+#include "glstate.h"
+#include "logging.h"
+
+static GLint64 batchBufferSize(GLuint buffer)
+{
+    GLint64 size = 0;
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glGetBufferParameteri64v(GL_COPY_WRITE_BUFFER, GL_BUFFER_SIZE, &size);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    return size;
+}
+
+int CreateDrawBatch(DrawBatch* batch, GLenum mode, size_t vertexStride, int maxVertices, int maxIndices, int maxDraws)
+{
+    memset(batch, 0, sizeof(DrawBatch));
+    batch->mode = mode;
+    batch->vertexStride = vertexStride;
+    batch->vertexCapacity = maxVertices;
+    batch->indexCapacity = maxIndices;
+    batch->drawCapacity = maxDraws;
+#ifndef BATCH_NO_INDIRECT
+    batch->indirect = GLAD_GL_VERSION_4_3 || GLAD_GL_ARB_multi_draw_indirect;
+#endif
+
+    batch->draws = (DrawElementsIndirectCommand*)malloc(sizeof(DrawElementsIndirectCommand) * (size_t)maxDraws);
+    batch->drawMaterials = (int*)malloc(sizeof(int) * (size_t)maxDraws);
+    batch->commands = (DrawElementsIndirectCommand*)malloc(sizeof(DrawElementsIndirectCommand) * (size_t)maxDraws);
+    if(!batch->indirect)
+    {
+        batch->fallbackCounts = (GLsizei*)malloc(sizeof(GLsizei) * (size_t)maxDraws);
+        batch->fallbackOffsets = (void**)malloc(sizeof(void*) * (size_t)maxDraws);
+        batch->fallbackBaseVertex = (GLint*)malloc(sizeof(GLint) * (size_t)maxDraws);
+    }
+    if(!batch->draws || !batch->drawMaterials || !batch->commands ||
+       (!batch->indirect && (!batch->fallbackCounts || !batch->fallbackOffsets || !batch->fallbackBaseVertex)))
+    {
+        logError(GL, "Unable to allocate a draw batch of %d draws", maxDraws);
+        DestroyDrawBatch(batch);
+        return 0;
+    }
+
+    glGenVertexArrays(1, &batch->vao);
+    glGenBuffers(1, &batch->vertexBuffer);
+    glGenBuffers(1, &batch->indexBuffer);
+
+    StateBindVertexArray(batch->vao);
+    StateBindBuffer(GL_ARRAY_BUFFER, batch->vertexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(vertexStride * (size_t)maxVertices), NULL, GL_STATIC_DRAW);
+    StateBindBuffer(GL_ELEMENT_ARRAY_BUFFER, batch->indexBuffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)(sizeof(GLuint) * (size_t)maxIndices), NULL, GL_STATIC_DRAW);
+    StateBindVertexArray(0);
+    StateBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    if(batch->indirect)
+    {
+        glGenBuffers(1, &batch->commandBuffer);
+        StateBindBuffer(GL_DRAW_INDIRECT_BUFFER, batch->commandBuffer);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, (GLsizeiptr)(sizeof(DrawElementsIndirectCommand) * (size_t)maxDraws), NULL, GL_STREAM_DRAW);
+        StateBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    }
+
+    // Checked by size, glGetError may still hold an error from before CreateDrawBatch.
+    if(batchBufferSize(batch->vertexBuffer) != (GLint64)(vertexStride * (size_t)maxVertices) ||
+       batchBufferSize(batch->indexBuffer) != (GLint64)(sizeof(GLuint) * (size_t)maxIndices) ||
+       (batch->indirect && batchBufferSize(batch->commandBuffer) != (GLint64)(sizeof(DrawElementsIndirectCommand) * (size_t)maxDraws)))
+    {
+        logError(GL, "Unable to create the draw batch buffers");
+        DestroyDrawBatch(batch);
+        return 0;
+    }
+    return 1;
+}
+
+int AddBatchMesh(DrawBatch* batch, const void* vertices, int vertexCount, const GLuint* indices, int indexCount)
+{
+    if(batch->vertexCount + vertexCount > batch->vertexCapacity || batch->indexCount + indexCount > batch->indexCapacity)
+    {
+        logError(GL, "Draw batch is full, unable to add a mesh of %d vertices", vertexCount);
+        return -1;
+    }
+    if(batch->meshCount == batch->meshCapacity)
+    {
+        int capacity = batch->meshCapacity ? batch->meshCapacity * 2 : 64;
+        BatchMesh* meshes = (BatchMesh*)realloc(batch->meshes, sizeof(BatchMesh) * (size_t)capacity);
+        if(meshes == NULL)
+        {
+            logError(GL, "Unable to allocate %d batch meshes", capacity);
+            return -1;
+        }
+        batch->meshes = meshes;
+        batch->meshCapacity = capacity;
+    }
+    BatchMesh* mesh = &batch->meshes[batch->meshCount];
+    mesh->firstIndex = (GLuint)batch->indexCount;
+    mesh->indexCount = (GLuint)indexCount;
+    mesh->baseVertex = batch->vertexCount;
+
+    // GL_COPY_WRITE_BUFFER leaves the element buffer of whatever VAO is bound alone.
+    glBindBuffer(GL_COPY_WRITE_BUFFER, batch->vertexBuffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)(batch->vertexStride * (size_t)batch->vertexCount), (GLsizeiptr)(batch->vertexStride * (size_t)vertexCount), vertices);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, batch->indexBuffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)(sizeof(GLuint) * (size_t)batch->indexCount), (GLsizeiptr)(sizeof(GLuint) * (size_t)indexCount), indices);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    batch->vertexCount += vertexCount;
+    batch->indexCount += indexCount;
+    return batch->meshCount++;
+}
+
+int AddBatchDraw(DrawBatch* batch, int material, int mesh, GLuint instanceCount, GLuint baseInstance)
+{
+    if(batch->drawCount >= batch->drawCapacity)
+    {
+        logError(GL, "Draw batch is full (%d draws)", batch->drawCapacity);
+        return 0;
+    }
+    if(material < 0 || material >= BATCH_MAX_MATERIALS || mesh < 0 || mesh >= batch->meshCount)
+    {
+        logError(GL, "Bad batch draw, material %d mesh %d", material, mesh);
+        return 0;
+    }
+    DrawElementsIndirectCommand* draw = &batch->draws[batch->drawCount];
+    draw->count = batch->meshes[mesh].indexCount;
+    draw->instanceCount = instanceCount;
+    draw->firstIndex = batch->meshes[mesh].firstIndex;
+    draw->baseVertex = batch->meshes[mesh].baseVertex;
+    draw->baseInstance = baseInstance;
+    batch->drawMaterials[batch->drawCount] = material;
+    batch->drawCount++;
+    return 1;
+}
+
+void ClearBatchDraws(DrawBatch* batch)
+{
+    batch->drawCount = 0;
+}
+
+void SubmitDrawBatch(DrawBatch* batch)
+{
+    PROFILE_BEGIN("SubmitDrawBatch");
+
+    // Counting sort, the order of draws within a material is kept.
+    int counts[BATCH_MAX_MATERIALS] = {0};
+    for(int i = 0; i < batch->drawCount; i++){counts[batch->drawMaterials[i]]++;}
+    batch->materialStart[0] = 0;
+    for(int m = 0; m < BATCH_MAX_MATERIALS; m++){batch->materialStart[m + 1] = batch->materialStart[m] + counts[m];}
+    int next[BATCH_MAX_MATERIALS];
+    memcpy(next, batch->materialStart, sizeof(next));
+    for(int i = 0; i < batch->drawCount; i++)
+    {
+        batch->commands[next[batch->drawMaterials[i]]++] = batch->draws[i];
+    }
+
+    if(batch->indirect)
+    {
+        // Orphan, last frame's commands may still be read.
+        GLsizeiptr size = (GLsizeiptr)(sizeof(DrawElementsIndirectCommand) * (size_t)batch->drawCapacity);
+        StateBindBuffer(GL_DRAW_INDIRECT_BUFFER, batch->commandBuffer);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, size, NULL, GL_STREAM_DRAW);
+        glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, (GLsizeiptr)(sizeof(DrawElementsIndirectCommand) * (size_t)batch->drawCount), batch->commands);
+    } else {
+        for(int i = 0; i < batch->drawCount; i++)
+        {
+            batch->fallbackCounts[i] = (GLsizei)batch->commands[i].count;
+            batch->fallbackOffsets[i] = (void*)(sizeof(GLuint) * (size_t)batch->commands[i].firstIndex);
+            batch->fallbackBaseVertex[i] = batch->commands[i].baseVertex;
+        }
+    }
+    PROFILE_END("SubmitDrawBatch");
+}
+
+void DrawBatchMaterial(DrawBatch* batch, int material)
+{
+    if(material < 0 || material >= BATCH_MAX_MATERIALS){return;}
+    int first = batch->materialStart[material];
+    int count = batch->materialStart[material + 1] - first;
+    if(count <= 0){return;}
+
+    StateBindVertexArray(batch->vao);
+    if(batch->indirect)
+    {
+        StateBindBuffer(GL_DRAW_INDIRECT_BUFFER, batch->commandBuffer);
+        glMultiDrawElementsIndirect(batch->mode, GL_UNSIGNED_INT, (void*)(sizeof(DrawElementsIndirectCommand) * (size_t)first), count, 0);
+        return;
+    }
+
+    // GL 3.3 : runs of single instance draws go out together, the others one by one.
+    int run = first;
+    for(int i = first; i <= first + count; i++)
+    {
+        if(i < first + count && batch->commands[i].instanceCount == 1){continue;}
+        if(i > run)
+        {
+            glMultiDrawElementsBaseVertex(batch->mode, &batch->fallbackCounts[run], GL_UNSIGNED_INT, (const void* const*)&batch->fallbackOffsets[run], i - run, &batch->fallbackBaseVertex[run]);
+        }
+        if(i < first + count && batch->commands[i].instanceCount > 1)
+        {
+            glDrawElementsInstancedBaseVertex(batch->mode, batch->fallbackCounts[i], GL_UNSIGNED_INT, batch->fallbackOffsets[i], (GLsizei)batch->commands[i].instanceCount, batch->fallbackBaseVertex[i]);
+        }
+        run = i + 1;
+    }
+}
+
+void DestroyDrawBatch(DrawBatch* batch)
+{
+    if(batch->vao){StateDeleteVertexArrays(1, &batch->vao);}
+    if(batch->vertexBuffer){StateDeleteBuffers(1, &batch->vertexBuffer);}
+    if(batch->indexBuffer){StateDeleteBuffers(1, &batch->indexBuffer);}
+    if(batch->commandBuffer){StateDeleteBuffers(1, &batch->commandBuffer);}
+    free(batch->meshes);
+    free(batch->draws);
+    free(batch->drawMaterials);
+    free(batch->commands);
+    free(batch->fallbackCounts);
+    free(batch->fallbackOffsets);
+    free(batch->fallbackBaseVertex);
+    memset(batch, 0, sizeof(DrawBatch));
+}
+
+#endif // BATCH_IMPLEMENTATION
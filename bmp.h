@@ -9,6 +9,9 @@
 #ifndef BMP_H
 #define BMP_H
 
+#include <stddef.h>  // size_t
+#include <stdio.h>   // FILE
+
 /*! @breif
     This allows you to load a BMP file. It can be 24 or 32 Bits.
 	@param[in] This is the path and name of the file to load.
@@ -27,10 +30,23 @@ unsigned char* LoadBMP(const char* fileName, int* width, int* height, unsigned s
 	@param[in] Red.
     @param[in] Green.
 	@param[in] Blue.
-	@return This will return the data of the image.
+	@return This will return the data of the image, NULL if the Bit Depth is not 24 or 32.
 */
 unsigned char* GenerateBMP(int width, int height, int bits, unsigned char red, unsigned char green, unsigned char blue, unsigned char alpha);
 
+/*! @breif
+    This fills a buffer you already have with one color, the same way GenerateBMP does.
+	@param[out] The buffer to fill. Needs Width * Height * (Bits / 8) bytes.
+	@param[in] The Width of the image.
+	@param[in] The Height of the image.
+	@param[in] The Bit Depth of the image. 24 or 32, anything else leaves the buffer alone.
+	@param[in] Red.
+    @param[in] Green.
+	@param[in] Blue.
+	@param[in] Alpha. Only used for 32 Bits.
+*/
+void FillBMP(unsigned char* data, int width, int height, int bits, unsigned char red, unsigned char green, unsigned char blue, unsigned char alpha);
+
 /*! @breif
     This allows you to save a BMP file. It can be 24 or 32 Bits.
 	@param[in] This is the path and name of the file to save.
@@ -41,22 +57,301 @@ unsigned char* GenerateBMP(int width, int height, int bits, unsigned char red, u
 */
 void SaveBMP(const char* fileName, unsigned char* data, int width, int height, unsigned short bitDepth);
 
+/*! @breif
+    A BMP file mapped straight into memory. Nothing is copied, pixels points into the file.
+    The pixels are in the files BGR / BGRA order, so swizzle is 1 and the upload should use
+    GL_BGR or GL_BGRA as the format. Rows are padded to 4 bytes, stride is the real row size.
+*/
+typedef struct BMPMapping
+{
+    const unsigned char* pixels;
+    int width;
+    int height;
+    unsigned short bitDepth;
+    size_t stride;
+    int swizzle;
+    void* base;
+    size_t size;
+#ifdef _WIN32
+    void* fileHandle;
+    void* mapHandle;
+#endif
+} BMPMapping;
+
+/*! @breif
+    This maps a BMP file into memory and validates the header. It can be 24 or 32 Bits.
+	@param[in] This is the path and name of the file to map.
+	@param[out] The mapping. Pixels, Width, Height and Bit Depth are filled in from the header.
+	@return 1 on success, 0 if the file could not be mapped or is not a valid BMP.
+*/
+int MapBMP(const char* fileName, BMPMapping* map);
+
+/*! @breif
+    This releases a mapping made with MapBMP. The pixels pointer is no longer valid after this.
+	@param[in] The mapping to release.
+*/
+void UnmapBMP(BMPMapping* map);
+
+/*! @breif
+    This copies the pixels of a mapping into a buffer you supply, swizzling BGR to RGB in a single pass.
+	@param[in] The mapping made with MapBMP.
+	@param[out] The buffer to fill. Needs Width * Height * (Bit Depth / 8) bytes, rows tightly packed.
+	@param[in] The size of the buffer in bytes.
+	@return 1 if the buffer was filled, 0 if it is too small.
+*/
+int CopyBMPPixels(const BMPMapping* map, unsigned char* data, size_t dataSize);
+
+/*! @breif
+    This loads a BMP file into a buffer you supply, swizzling BGR to RGB in a single pass.
+    Call it with a NULL buffer to get the Width, Height and Bit Depth so you can size it.
+	@param[in] This is the path and name of the file to load.
+	@param[out] The buffer to fill. Needs Width * Height * (Bit Depth / 8) bytes.
+	@param[in] The size of the buffer in bytes.
+	@param[out] The Width of the image. This is pulled from the image header.
+	@param[out] The Height of the image. This is pulled from the image header.
+	@param[out] The Bit Depth of the image. This is pulled from the image header.
+	@return 1 if the buffer was filled, 0 otherwise.
+*/
+int LoadBMPInto(const char* fileName, unsigned char* data, size_t dataSize, int* width, int* height, unsigned short* bd);
+
+/*! @breif
+    A BMP file being written a few rows at a time. The only extra memory is one row.
+*/
+typedef struct BMPWriter
+{
+    FILE* file;
+    unsigned char* row;
+    int width;
+    int height;
+    unsigned short bitDepth;
+    int rowsWritten;
+} BMPWriter;
+
+/*! @breif
+    This opens a BMP file for streaming and writes the header. It can be 24 or 32 Bits.
+	@param[out] The writer to set up.
+	@param[in] This is the path and name of the file to save.
+	@param[in] The user specifies the Width of the image.
+	@param[in] The user specifies the Height of the image.
+	@param[in] The user specifies the Bit Depth of the image.
+	@return 1 on success, 0 if the file could not be opened.
+*/
+int OpenBMPWriter(BMPWriter* writer, const char* fileName, int width, int height, unsigned short bitDepth);
+
+/*! @breif
+    This swizzles and writes the next rows of the image. Rows go bottom to top, the same
+    order SaveBMP and glReadPixels use.
+	@param[in] The writer.
+	@param[in] The RGB / RGBA rows, tightly packed.
+	@param[in] How many rows to write.
+	@return The number of rows written.
+*/
+int WriteBMPRows(BMPWriter* writer, const unsigned char* rows, int rowCount);
+
+/*! @breif
+    This closes the file and frees the row buffer.
+	@param[in] The writer.
+	@return 1 if every row of the image was written, 0 otherwise.
+*/
+int CloseBMPWriter(BMPWriter* writer);
+
 #endif // BMP_H
 
-#ifdef BMP_IMPLEMENTATION
+#if defined(BMP_IMPLEMENTATION) && !defined(BMP_IMPLEMENTATION_DONE)
+#define BMP_IMPLEMENTATION_DONE
 
 #include <stdio.h>   // FILE  fclose()  fopen()
 #include <stdlib.h>  // malloc
+#include <string.h>  // memset()
+#include "profiler.h"
+
+#ifdef _WIN32
+#include <windows.h> // CreateFileMappingA()  MapViewOfFile()
+#else
+#include <fcntl.h>    // open()
+#include <sys/mman.h> // mmap()  munmap()
+#include <sys/stat.h> // fstat()
+#include <unistd.h>   // close()
+#endif
+
+// Define BMP_NO_SIMD to force the plain C swizzle.
+#if !defined(BMP_NO_SIMD) && (defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86))
+#define BMP_SIMD_X86 1
+#include <immintrin.h> // _mm_shuffle_epi8()  _mm256_shuffle_epi8()
+#if defined(_MSC_VER)
+#include <intrin.h>    // __cpuid()  _xgetbv()
+#define BMP_TARGET(x)
+#else
+#define BMP_TARGET(x) __attribute__((target(x)))
+#endif
+#elif !defined(BMP_NO_SIMD) && (defined(__aarch64__) || defined(_M_ARM64))
+#define BMP_SIMD_NEON 1
+#include <arm_neon.h>  // vld3q_u8()  vst3q_u8()
+#endif
+
+static void bmpSwizzleScalar(unsigned char* dst, const unsigned char* src, size_t totalBytes, int loopBytes)
+{
+    // BGR(A) <--> RGB(A). Safe to call with dst == src.
+    for(size_t t = 0; t + loopBytes <= totalBytes; t += loopBytes)
+    {
+        unsigned char b = src[t];
+        dst[t]     = src[t + 2];
+        dst[t + 1] = src[t + 1];
+        dst[t + 2] = b;
+        if(loopBytes == 4)
+        {
+            dst[t + 3] = src[t + 3];
+        }
+    }
+}
+
+#if BMP_SIMD_X86
+
+// The 24 bit kernels shuffle 4 pixels (12 bytes) out of every 16 byte load and put bytes 12-15
+// back untouched, so the next step can safely overlap them. This keeps dst == src working.
+
+BMP_TARGET("ssse3")
+static void bmpSwizzleSSSE3(unsigned char* dst, const unsigned char* src, size_t totalBytes, int loopBytes)
+{
+    size_t t = 0;
+    if(loopBytes == 4)
+    {
+        const __m128i mask = _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+        for(; t + 16 <= totalBytes; t += 16)
+        {
+            __m128i v = _mm_loadu_si128((const __m128i*)(src + t));
+            _mm_storeu_si128((__m128i*)(dst + t), _mm_shuffle_epi8(v, mask));
+        }
+    } else {
+        const __m128i mask = _mm_setr_epi8(2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 12, 13, 14, 15);
+        for(; t + 16 <= totalBytes; t += 12)
+        {
+            __m128i v = _mm_loadu_si128((const __m128i*)(src + t));
+            _mm_storeu_si128((__m128i*)(dst + t), _mm_shuffle_epi8(v, mask));
+        }
+    }
+    bmpSwizzleScalar(dst + t, src + t, totalBytes - t, loopBytes);
+}
+
+BMP_TARGET("avx2")
+static void bmpSwizzleAVX2(unsigned char* dst, const unsigned char* src, size_t totalBytes, int loopBytes)
+{
+    size_t t = 0;
+    if(loopBytes == 4)
+    {
+        const __m256i mask = _mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+                                              2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+        for(; t + 32 <= totalBytes; t += 32)
+        {
+            __m256i v = _mm256_loadu_si256((const __m256i*)(src + t));
+            _mm256_storeu_si256((__m256i*)(dst + t), _mm256_shuffle_epi8(v, mask));
+        }
+    } else {
+        // Each 128 bit lane takes 4 pixels, the lanes start 12 bytes apart.
+        const __m256i mask = _mm256_setr_epi8(2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 12, 13, 14, 15,
+                                              2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 12, 13, 14, 15);
+        for(; t + 28 <= totalBytes; t += 24)
+        {
+            __m128i lo = _mm_loadu_si128((const __m128i*)(src + t));
+            __m128i hi = _mm_loadu_si128((const __m128i*)(src + t + 12));
+            __m256i v = _mm256_shuffle_epi8(_mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1), mask);
+            _mm_storeu_si128((__m128i*)(dst + t), _mm256_castsi256_si128(v));
+            _mm_storeu_si128((__m128i*)(dst + t + 12), _mm256_extracti128_si256(v, 1));
+        }
+    }
+    bmpSwizzleScalar(dst + t, src + t, totalBytes - t, loopBytes);
+}
+
+#endif // BMP_SIMD_X86
+
+#if BMP_SIMD_NEON
+
+static void bmpSwizzleNEON(unsigned char* dst, const unsigned char* src, size_t totalBytes, int loopBytes)
+{
+    size_t t = 0;
+    if(loopBytes == 4)
+    {
+        for(; t + 64 <= totalBytes; t += 64)
+        {
+            uint8x16x4_t v = vld4q_u8(src + t);
+            uint8x16_t b = v.val[0];
+            v.val[0] = v.val[2];
+            v.val[2] = b;
+            vst4q_u8(dst + t, v);
+        }
+    } else {
+        for(; t + 48 <= totalBytes; t += 48)
+        {
+            uint8x16x3_t v = vld3q_u8(src + t);
+            uint8x16_t b = v.val[0];
+            v.val[0] = v.val[2];
+            v.val[2] = b;
+            vst3q_u8(dst + t, v);
+        }
+    }
+    bmpSwizzleScalar(dst + t, src + t, totalBytes - t, loopBytes);
+}
+
+#endif // BMP_SIMD_NEON
+
+typedef void (*bmpSwizzleFunc)(unsigned char* dst, const unsigned char* src, size_t totalBytes, int loopBytes);
+
+static bmpSwizzleFunc bmpPickSwizzle(void)
+{
+#if BMP_SIMD_X86
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    int maxLeaf = info[0];
+    __cpuid(info, 1);
+    int hasSSSE3 = (info[2] >> 9) & 1;
+    int hasAVX2 = 0;
+    if(maxLeaf >= 7 && ((info[2] >> 27) & 1) && ((info[2] >> 28) & 1) && (_xgetbv(0) & 6) == 6)
+    {
+        __cpuidex(info, 7, 0);
+        hasAVX2 = (info[1] >> 5) & 1;
+    }
+    if(hasAVX2){return bmpSwizzleAVX2;}
+    if(hasSSSE3){return bmpSwizzleSSSE3;}
+#else
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")){return bmpSwizzleAVX2;}
+    if(__builtin_cpu_supports("ssse3")){return bmpSwizzleSSSE3;}
+#endif
+#elif BMP_SIMD_NEON
+    return bmpSwizzleNEON;
+#endif
+    return bmpSwizzleScalar;
+}
+
+static void bmpSwizzle(unsigned char* dst, const unsigned char* src, size_t totalBytes, int loopBytes)
+{
+    // The CPU check runs once. Every thread picks the same kernel, so the race is harmless.
+    static bmpSwizzleFunc swizzle = NULL;
+    if(swizzle == NULL){swizzle = bmpPickSwizzle();}
+    swizzle(dst, src, totalBytes, loopBytes);
+}
+
+// Every row in the file is padded to a multiple of 4 bytes. Only 24 Bit rows ever need it.
+static size_t bmpStride(int width, int bitDepth)
+{
+    return ((size_t)width * (size_t)(bitDepth / 8) + 3) & ~(size_t)3;
+}
+
+static unsigned int bmpRead32(const unsigned char* p)
+{
+    return (unsigned int)p[0] | ((unsigned int)p[1] << 8) | ((unsigned int)p[2] << 16) | ((unsigned int)p[3] << 24);
+}
 
 unsigned char* LoadBMP(const char* fileName, int* width, int* height, unsigned short* bd)
 {
+    PROFILE_BEGIN("LoadBMP");
     FILE* pFile = fopen(fileName, "rb");
     if(pFile)
     {
         unsigned char* data = NULL;
         if(fgetc(pFile) == 'B' && fgetc(pFile) == 'M')
         {
-            unsigned char* tempData = NULL;
             unsigned int image_data_address;
             int w, h, bitDepth;
 
@@ -72,69 +367,235 @@ unsigned char* LoadBMP(const char* fileName, int* width, int* height, unsigned s
             h = *height;
             bitDepth = *bd;
 
-            int totalBytes = ((w * h) * (bitDepth / 8)) * sizeof(unsigned char);
-            tempData = malloc(totalBytes * sizeof(unsigned char));
+            // One buffer, swizzled in place. No second copy of the image.
+            size_t rowBytes = (size_t)w * (bitDepth / 8);
+            size_t stride = bmpStride(w, bitDepth);
+            size_t totalBytes = rowBytes * h;
+            data = malloc(totalBytes * sizeof(unsigned char));
             fseek(pFile, image_data_address, SEEK_SET);
-            int bytes_read = fread(tempData, sizeof(unsigned char), totalBytes, pFile);
-            if(tempData != NULL && bytes_read > 0)
+            if(data != NULL)
             {
-                data = calloc(totalBytes, sizeof(unsigned char));
-                int c = 0;
-                int LoopBytes = 3;
-                if(bitDepth == 32){LoopBytes = 4;}
-                for(int t = 0; t < totalBytes; t+=LoopBytes) // ARGB  |  Opengl == RGBA
+                size_t bytes_read = 0;
+                if(stride == rowBytes)
                 {
-                    data[c] = tempData[t + 2];
-                    c++;
-                    data[c] = tempData[t + 1];
-                    c++;
-                    data[c] = tempData[t];
-                    c++;
-                    if(LoopBytes == 4)
+                    bytes_read = fread(data, sizeof(unsigned char), totalBytes, pFile);
+                } else {
+                    // Padded rows are read one at a time, skipping the padding.
+                    for(int y = 0; y < h; y++)
                     {
-                        data[c] = tempData[t + 3];
-                        c++;
+                        if(fread(data + rowBytes * y, 1, rowBytes, pFile) != rowBytes){break;}
+                        bytes_read += rowBytes;
+                        if(y + 1 < h){fseek(pFile, (long)(stride - rowBytes), SEEK_CUR);}
                     }
                 }
-                free(tempData);
+                if(bytes_read > 0)
+                {
+                    bmpSwizzle(data, data, totalBytes, (bitDepth == 32) ? 4 : 3); // ARGB  |  Opengl == RGBA
+                } else {
+                    free(data);
+                    data = NULL;
+                }
             }
         }
         fclose(pFile);
+        PROFILE_END("LoadBMP");
         return data;
     }
 
+    PROFILE_END("LoadBMP");
     return 0;
 }
 
-unsigned char* GenerateBMP(int width, int height, int bits, unsigned char red, unsigned char green, unsigned char blue, unsigned char alpha)
+int MapBMP(const char* fileName, BMPMapping* map)
+{
+    memset(map, 0, sizeof(BMPMapping));
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if(file == INVALID_HANDLE_VALUE){return 0;}
+    LARGE_INTEGER fileSize;
+    if(!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart < 54)
+    {
+        CloseHandle(file);
+        return 0;
+    }
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if(mapping == NULL)
+    {
+        CloseHandle(file);
+        return 0;
+    }
+    map->base = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    map->fileHandle = file;
+    map->mapHandle = mapping;
+    map->size = (size_t)fileSize.QuadPart;
+    if(map->base == NULL)
+    {
+        UnmapBMP(map);
+        return 0;
+    }
+#else
+    int fd = open(fileName, O_RDONLY);
+    if(fd < 0){return 0;}
+    struct stat st;
+    if(fstat(fd, &st) != 0 || st.st_size < 54)
+    {
+        close(fd);
+        return 0;
+    }
+    void* base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // The mapping keeps the file alive.
+    if(base == MAP_FAILED){return 0;}
+    map->base = base;
+    map->size = (size_t)st.st_size;
+#endif
+
+    const unsigned char* file = (const unsigned char*)map->base;
+    unsigned int image_data_address = bmpRead32(file + 10);
+    int w = (int)bmpRead32(file + 18);
+    int h = (int)bmpRead32(file + 22);
+    unsigned short bitDepth = (unsigned short)(file[28] | (file[29] << 8));
+
+    if(file[0] != 'B' || file[1] != 'M' || w <= 0 || h <= 0 || (bitDepth != 24 && bitDepth != 32))
+    {
+        UnmapBMP(map);
+        return 0;
+    }
+
+    // The last row's padding is not always in the file, so only its pixels are required.
+    size_t stride = bmpStride(w, bitDepth);
+    size_t totalBytes = stride * (size_t)(h - 1) + (size_t)w * (bitDepth / 8);
+    if(image_data_address > map->size || totalBytes > map->size - image_data_address)
+    {
+        UnmapBMP(map);
+        return 0;
+    }
+
+    map->pixels = file + image_data_address;
+    map->width = w;
+    map->height = h;
+    map->bitDepth = bitDepth;
+    map->stride = stride;
+    map->swizzle = 1;
+    return 1;
+}
+
+void UnmapBMP(BMPMapping* map)
+{
+#ifdef _WIN32
+    if(map->base){UnmapViewOfFile(map->base);}
+    if(map->mapHandle){CloseHandle((HANDLE)map->mapHandle);}
+    if(map->fileHandle){CloseHandle((HANDLE)map->fileHandle);}
+#else
+    if(map->base){munmap(map->base, map->size);}
+#endif
+    memset(map, 0, sizeof(BMPMapping));
+}
+
+int LoadBMPInto(const char* fileName, unsigned char* data, size_t dataSize, int* width, int* height, unsigned short* bd)
+{
+    BMPMapping map;
+    PROFILE_BEGIN("LoadBMPInto");
+    if(!MapBMP(fileName, &map))
+    {
+        PROFILE_END("LoadBMPInto");
+        return 0;
+    }
+
+    *width = map.width;
+    *height = map.height;
+    *bd = map.bitDepth;
+
+    int result = (data != NULL) ? CopyBMPPixels(&map, data, dataSize) : 0;
+    UnmapBMP(&map);
+    PROFILE_END("LoadBMPInto");
+    return result;
+}
+
+int CopyBMPPixels(const BMPMapping* map, unsigned char* data, size_t dataSize)
+{
+    size_t rowBytes = (size_t)map->width * (map->bitDepth / 8);
+    size_t totalBytes = rowBytes * (size_t)map->height;
+    if(dataSize < totalBytes){return 0;}
+    if(map->stride == rowBytes)
+    {
+        bmpSwizzle(data, map->pixels, totalBytes, map->bitDepth / 8);
+    } else {
+        for(int y = 0; y < map->height; y++)
+        {
+            bmpSwizzle(data + rowBytes * y, map->pixels + map->stride * y, rowBytes, map->bitDepth / 8);
+        }
+    }
+    return 1;
+}
+
+void FillBMP(unsigned char* data, int width, int height, int bits, unsigned char red, unsigned char green, unsigned char blue, unsigned char alpha)
 {
-    unsigned char* data = NULL;
-    int loopBits = (bits / 8);
-    int totalBytes = ((width * height) * loopBits) * sizeof(unsigned char);
-    data = calloc(totalBytes, sizeof(unsigned char));
-    for(int t = 0; t < totalBytes;)
+    if(bits != 24 && bits != 32){return;}
+
+    // 48 bytes is 16 pixels at 24 Bits and 12 pixels at 32 Bits, so the pattern
+    // always lines up with a 16 byte store.
+    unsigned char pattern[48];
+    int loopBits = bits / 8;
+    for(int t = 0; t < 48; t += loopBits)
     {
-        data[t] = red;
-        t++;
-        data[t] = green;
-        t++;
-        data[t] = blue;
-        t++;
+        pattern[t]     = red;
+        pattern[t + 1] = green;
+        pattern[t + 2] = blue;
         if(loopBits == 4)
         {
-            data[t] = alpha;
-            t++;
+            pattern[t + 3] = alpha;
         }
     }
+
+    size_t totalBytes = (size_t)width * (size_t)height * loopBits;
+    size_t t = 0;
+#if BMP_SIMD_X86 && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+    __m128i p0 = _mm_loadu_si128((const __m128i*)(pattern));
+    __m128i p1 = _mm_loadu_si128((const __m128i*)(pattern + 16));
+    __m128i p2 = _mm_loadu_si128((const __m128i*)(pattern + 32));
+    for(; t + 48 <= totalBytes; t += 48)
+    {
+        _mm_storeu_si128((__m128i*)(data + t), p0);
+        _mm_storeu_si128((__m128i*)(data + t + 16), p1);
+        _mm_storeu_si128((__m128i*)(data + t + 32), p2);
+    }
+#elif BMP_SIMD_NEON
+    uint8x16x3_t p = {{vld1q_u8(pattern), vld1q_u8(pattern + 16), vld1q_u8(pattern + 32)}};
+    for(; t + 48 <= totalBytes; t += 48)
+    {
+        vst1q_u8(data + t, p.val[0]);
+        vst1q_u8(data + t + 16, p.val[1]);
+        vst1q_u8(data + t + 32, p.val[2]);
+    }
+#else
+    for(; t + 48 <= totalBytes; t += 48)
+    {
+        memcpy(data + t, pattern, 48);
+    }
+#endif
+    memcpy(data + t, pattern, totalBytes - t);
+}
+
+unsigned char* GenerateBMP(int width, int height, int bits, unsigned char red, unsigned char green, unsigned char blue, unsigned char alpha)
+{
+    if(bits != 24 && bits != 32){return NULL;}
+
+    // No calloc, every byte gets written by FillBMP anyway.
+    unsigned char* data = malloc((size_t)width * (size_t)height * (bits / 8));
+    if(data != NULL)
+    {
+        FillBMP(data, width, height, bits, red, green, blue, alpha);
+    }
     return data;
 }
 
-void SaveBMP(const char* fileName, unsigned char* data, int width, int height, unsigned short bitDepth)
+static int bmpWriteHeader(FILE* pFile, int width, int height, unsigned short bitDepth)
 {
     int HeaderSize = 54;
     int bmpInfoSize = 40;
     if(bitDepth == 32){HeaderSize = 138; bmpInfoSize = 124;}
-    int dSize = ((width * height) * (bitDepth / 8));
+    int dSize = (int)bmpStride(width, bitDepth) * height;
     int tSize = HeaderSize + dSize;
     int ppm = 2835;
     unsigned char bmpHeader[14] = {'B', 'M', 0, 0, 0, 0, 0, 0, 0, 0, HeaderSize, 0, 0, 0};
@@ -202,31 +663,66 @@ void SaveBMP(const char* fileName, unsigned char* data, int width, int height, u
         bmpInfo[59] = 0x73;
     }
 
-    unsigned char* tempChar = malloc(dSize * sizeof(unsigned char));
-    int c = 0;
-    for(int t = 0; t < dSize; t+=LoopBytes)
+    if(bitDepth == 24){bmpInfoSize = 40;}
+    fwrite(bmpHeader, 1, 14, pFile);
+    return fwrite(bmpInfo, 1, bmpInfoSize, pFile) == (size_t)bmpInfoSize;
+}
+
+int OpenBMPWriter(BMPWriter* writer, const char* fileName, int width, int height, unsigned short bitDepth)
+{
+    memset(writer, 0, sizeof(BMPWriter));
+    writer->file = fopen(fileName, "wb");
+    if(writer->file == NULL){return 0;}
+
+    // Zeroed, so the padding at the end of each row is written as 0.
+    writer->row = calloc(bmpStride(width, bitDepth), 1);
+    if(writer->row == NULL || !bmpWriteHeader(writer->file, width, height, bitDepth))
+    {
+        CloseBMPWriter(writer);
+        return 0;
+    }
+    writer->width = width;
+    writer->height = height;
+    writer->bitDepth = bitDepth;
+    return 1;
+}
+
+int WriteBMPRows(BMPWriter* writer, const unsigned char* rows, int rowCount)
+{
+    if(writer->file == NULL){return 0;}
+
+    size_t rowBytes = (size_t)writer->width * (writer->bitDepth / 8);
+    size_t stride = bmpStride(writer->width, writer->bitDepth);
+    int written = 0;
+    while(written < rowCount && writer->rowsWritten < writer->height)
     {
-        tempChar[c] = data[t + 2];
-        c++;
-        tempChar[c] = data[t + 1];
-        c++;
-        tempChar[c] = data[t];
-        c++;
-        if(LoopBytes == 4)
-        {
-            tempChar[c] = data[t + 3];
-            c++;
-        }
+        bmpSwizzle(writer->row, rows + rowBytes * written, rowBytes, writer->bitDepth / 8);
+        if(fwrite(writer->row, 1, stride, writer->file) != stride){break;}
+        writer->rowsWritten++;
+        written++;
     }
+    return written;
+}
 
-    FILE* pFile;
-    pFile = fopen(fileName, "wb");
-    fwrite(bmpHeader, 1, 14, pFile);
-    if(bitDepth == 24){bmpInfoSize = 40;}
-    fwrite(bmpInfo, 1, bmpInfoSize, pFile);
-    fwrite(tempChar, 1, dSize, pFile);
-    fclose(pFile);
-    free(tempChar);
+int CloseBMPWriter(BMPWriter* writer)
+{
+    int complete = (writer->file != NULL && writer->rowsWritten == writer->height);
+    if(writer->file){fclose(writer->file);}
+    free(writer->row);
+    memset(writer, 0, sizeof(BMPWriter));
+    return complete;
+}
+
+void SaveBMP(const char* fileName, unsigned char* data, int width, int height, unsigned short bitDepth)
+{
+    BMPWriter writer;
+    PROFILE_BEGIN("SaveBMP");
+    if(OpenBMPWriter(&writer, fileName, width, height, bitDepth))
+    {
+        WriteBMPRows(&writer, data, height);
+        CloseBMPWriter(&writer);
+    }
+    PROFILE_END("SaveBMP");
 }
 
 #endif // BMP_IMPLEMENTATION
@@ -0,0 +1,331 @@
+/*!
+@author ThatOSDev
+@NOTE
+#define CAPTURE_IMPLEMENTATION
+#include "capture.h"
+
+Needs bmp.h with BMP_IMPLEMENTATION somewhere in the program, and a GL 3.3 context.
+The size is fixed when the capture starts, stop it when the framebuffer is resized.
+
+EXAMPLE :
+    FrameCapture capture;
+    StartFrameCapture(&capture, "frame_%05d.bmp", width, height);
+    while(...)
+    {
+        // draw
+        CaptureFrame(&capture);
+        glfwSwapBuffers(window);
+    }
+    StopFrameCapture(&capture);
+*/
+
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <glad/gl.h>
+#include "thread.h"
+
+// How many frames can be in flight between glReadPixels and the writer thread.
+#ifndef CAPTURE_RING_SIZE
+#define CAPTURE_RING_SIZE 4
+#endif
+
+// How many one second waits a frame gets at StopFrameCapture before it is dropped.
+#ifndef CAPTURE_STOP_WAITS
+#define CAPTURE_STOP_WAITS 3
+#endif
+
+typedef enum CaptureSlotState
+{
+    CAPTURE_SLOT_FREE = 0,
+    CAPTURE_SLOT_READING,  // glReadPixels issued, waiting on the fence.
+    CAPTURE_SLOT_WRITING,  // Mapped, owned by the writer thread.
+    CAPTURE_SLOT_WRITTEN   // The writer is done, needs unmapping on the GL thread.
+} CaptureSlotState;
+
+typedef struct CaptureSlot
+{
+    GLuint pbo;
+    GLsync fence;
+    const unsigned char* pixels;
+    int frame;
+    int waits;
+    CaptureSlotState state;
+} CaptureSlot;
+
+typedef struct FrameCapture
+{
+    CaptureSlot slots[CAPTURE_RING_SIZE];
+    int queue[CAPTURE_RING_SIZE];  // Slots waiting for the writer, in frame order.
+    int queueHead;
+    int queueCount;
+    char filePattern[256];
+    int width;
+    int height;
+    int frame;
+    int framesWritten;
+    int framesDropped;
+    int active;
+    int quit;
+    Thread writer;
+    Mutex lock;
+    CondVar wake;
+} FrameCapture;
+
+/*! @breif
+    This starts capturing frames. Every frame passed to CaptureFrame is saved as a 32 Bit BMP.
+	@param[out] The capture to set up.
+	@param[in] A printf pattern for the file names, it gets the frame number. "frame_%05d.bmp"
+	@param[in] The Width of the framebuffer.
+	@param[in] The Height of the framebuffer.
+	@return 1 on success, 0 otherwise.
+*/
+int StartFrameCapture(FrameCapture* capture, const char* filePattern, int width, int height);
+
+/*! @breif
+    This queues a read of the current framebuffer. It never waits on the GPU or the disk,
+    if every slot is busy the frame is dropped and counted instead. Call it before swapping.
+	@param[in] The capture.
+*/
+void CaptureFrame(FrameCapture* capture);
+
+/*! @breif
+    This finishes the frames still in flight, stops the writer thread and logs how many
+    frames were written and dropped.
+	@param[in] The capture.
+*/
+void StopFrameCapture(FrameCapture* capture);
+
+#endif // CAPTURE_H
+
+#if defined(CAPTURE_IMPLEMENTATION) && !defined(CAPTURE_IMPLEMENTATION_DONE)
+#define CAPTURE_IMPLEMENTATION_DONE
+
+#include <stdio.h>   // snprintf()
+#include <string.h>  // memset()  strncpy()
+#include "bmp.h"
+#include "logging.h"
+#include "profiler.h"
+
+static int captureWriterThread(void* arg)
+{
+    FrameCapture* capture = (FrameCapture*)arg;
+    size_t rowBytes = (size_t)capture->width * 4;
+    PROFILE_THREAD("frame capture");
+
+    MutexLock(&capture->lock);
+    for(;;)
+    {
+        while(capture->queueCount == 0 && !capture->quit)
+        {
+            CondWait(&capture->wake, &capture->lock);
+        }
+        if(capture->queueCount == 0){break;}
+
+        CaptureSlot* slot = &capture->slots[capture->queue[capture->queueHead]];
+        capture->queueHead = (capture->queueHead + 1) % CAPTURE_RING_SIZE;
+        capture->queueCount--;
+        MutexUnlock(&capture->lock);
+
+        PROFILE_BEGIN("WriteCaptureFrame");
+        char fileName[300];
+        snprintf(fileName, sizeof(fileName), capture->filePattern, slot->frame);
+        BMPWriter writer;
+        int ok = 0;
+        if(OpenBMPWriter(&writer, fileName, capture->width, capture->height, 32))
+        {
+            for(int y = 0; y < capture->height; y++)
+            {
+                WriteBMPRows(&writer, slot->pixels + rowBytes * y, 1);
+            }
+            ok = CloseBMPWriter(&writer);
+        }
+        if(!ok)
+        {
+            logError(BMP, "Unable to write capture frame : %s", fileName);
+        }
+        PROFILE_END("WriteCaptureFrame");
+
+        MutexLock(&capture->lock);
+        slot->state = CAPTURE_SLOT_WRITTEN;
+        if(ok){capture->framesWritten++;}
+    }
+    MutexUnlock(&capture->lock);
+    return 0;
+}
+
+static void captureRecycle(FrameCapture* capture, int wait)
+{
+    // GL thread only. Hands finished reads to the writer and unmaps what it is done with.
+    for(int i = 0; i < CAPTURE_RING_SIZE; i++)
+    {
+        CaptureSlot* slot = &capture->slots[i];
+
+        MutexLock(&capture->lock);
+        CaptureSlotState state = slot->state;
+        MutexUnlock(&capture->lock);
+
+        if(state == CAPTURE_SLOT_WRITTEN)
+        {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, slot->pbo);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            slot->pixels = NULL;
+            MutexLock(&capture->lock);
+            slot->state = CAPTURE_SLOT_FREE;
+            MutexUnlock(&capture->lock);
+        }
+    }
+
+    // Hand over in frame order, so the writer sees frames in sequence.
+    for(;;)
+    {
+        CaptureSlot* next = NULL;
+        MutexLock(&capture->lock);
+        for(int i = 0; i < CAPTURE_RING_SIZE; i++)
+        {
+            CaptureSlot* slot = &capture->slots[i];
+            if(slot->state == CAPTURE_SLOT_READING && (next == NULL || slot->frame < next->frame))
+            {
+                next = slot;
+            }
+        }
+        MutexUnlock(&capture->lock);
+        if(next == NULL){break;}
+
+        GLuint64 timeout = wait ? 1000000000ull : 0;
+        GLenum result = glClientWaitSync(next->fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, timeout);
+        if(result == GL_TIMEOUT_EXPIRED && !(wait && ++next->waits >= CAPTURE_STOP_WAITS)){break;}
+
+        glDeleteSync(next->fence);
+        next->fence = NULL;
+        if(result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED)
+        {
+            // The wait failed or never finished, most likely a lost context. The frame is given up.
+            MutexLock(&capture->lock);
+            next->state = CAPTURE_SLOT_FREE;
+            capture->framesDropped++;
+            MutexUnlock(&capture->lock);
+            continue;
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, next->pbo);
+        next->pixels = (const unsigned char*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)capture->width * capture->height * 4, GL_MAP_READ_BIT);
+
+        MutexLock(&capture->lock);
+        if(next->pixels == NULL)
+        {
+            next->state = CAPTURE_SLOT_FREE;
+            capture->framesDropped++;
+        } else {
+            next->state = CAPTURE_SLOT_WRITING;
+            capture->queue[(capture->queueHead + capture->queueCount) % CAPTURE_RING_SIZE] = (int)(next - capture->slots);
+            capture->queueCount++;
+            CondSignal(&capture->wake);
+        }
+        MutexUnlock(&capture->lock);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+int StartFrameCapture(FrameCapture* capture, const char* filePattern, int width, int height)
+{
+    memset(capture, 0, sizeof(FrameCapture));
+    strncpy(capture->filePattern, filePattern, sizeof(capture->filePattern) - 1);
+    capture->width = width;
+    capture->height = height;
+
+    for(int i = 0; i < CAPTURE_RING_SIZE; i++)
+    {
+        glGenBuffers(1, &capture->slots[i].pbo);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, capture->slots[i].pbo);
+        glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)width * height * 4, NULL, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    MutexInit(&capture->lock);
+    CondInit(&capture->wake);
+    if(!ThreadStart(&capture->writer, captureWriterThread, capture))
+    {
+        logError(BMP, "Unable to start the frame capture thread");
+        for(int i = 0; i < CAPTURE_RING_SIZE; i++)
+        {
+            glDeleteBuffers(1, &capture->slots[i].pbo);
+        }
+        CondDestroy(&capture->wake);
+        MutexDestroy(&capture->lock);
+        return 0;
+    }
+    capture->active = 1;
+    return 1;
+}
+
+void CaptureFrame(FrameCapture* capture)
+{
+    if(!capture->active){return;}
+
+    captureRecycle(capture, 0);
+
+    CaptureSlot* slot = NULL;
+    MutexLock(&capture->lock);
+    for(int i = 0; i < CAPTURE_RING_SIZE; i++)
+    {
+        if(capture->slots[i].state == CAPTURE_SLOT_FREE)
+        {
+            slot = &capture->slots[i];
+            break;
+        }
+    }
+    if(slot == NULL){capture->framesDropped++;}
+    MutexUnlock(&capture->lock);
+
+    int frame = capture->frame++;
+    if(slot == NULL){return;}
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot->pbo);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, capture->width, capture->height, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    slot->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot->frame = frame;
+    slot->waits = 0;
+    MutexLock(&capture->lock);
+    slot->state = CAPTURE_SLOT_READING;
+    MutexUnlock(&capture->lock);
+}
+
+void StopFrameCapture(FrameCapture* capture)
+{
+    if(!capture->active){return;}
+
+    // Blocking is fine here, the capture is over.
+    int pending;
+    do
+    {
+        captureRecycle(capture, 1);
+        pending = 0;
+        MutexLock(&capture->lock);
+        for(int i = 0; i < CAPTURE_RING_SIZE; i++)
+        {
+            if(capture->slots[i].state != CAPTURE_SLOT_FREE){pending = 1;}
+        }
+        MutexUnlock(&capture->lock);
+        if(pending){ThreadYield();}
+    } while(pending);
+
+    MutexLock(&capture->lock);
+    capture->quit = 1;
+    CondSignal(&capture->wake);
+    MutexUnlock(&capture->lock);
+    ThreadJoin(&capture->writer);
+
+    for(int i = 0; i < CAPTURE_RING_SIZE; i++)
+    {
+        glDeleteBuffers(1, &capture->slots[i].pbo);
+    }
+    CondDestroy(&capture->wake);
+    MutexDestroy(&capture->lock);
+    capture->active = 0;
+
+    logInfo(BMP, "Frame capture wrote %d frames, dropped %d", capture->framesWritten, capture->framesDropped);
+}
+
+#endif // CAPTURE_IMPLEMENTATION
@@ -0,0 +1,161 @@
+/*!
+@author ThatOSDev
+@NOTE
+#define FENCERING_IMPLEMENTATION
+#include "fencering.h"
+
+The part stream.h and ubo.h share : one buffer split into per frame regions, each guarded by a
+fence, so the CPU only writes a region again once the GPU is done reading it. With GL 4.4 or
+ARB_buffer_storage the buffer can be mapped once, persistent and coherent, otherwise it is a
+plain buffer and the caller uploads or maps it itself.
+
+Everything goes through GL_COPY_WRITE_BUFFER, so the caller's buffer bindings are left alone.
+
+EXAMPLE :
+    FenceRing ring;
+    CreateFenceRing(&ring, 64 * 1024, 3, 1, GL_STREAM_DRAW);
+    while(...)
+    {
+        WaitFenceRing(&ring);      // Region ring.frame is free to write now.
+        // write at ring.frameSize * ring.frame, draw
+        AdvanceFenceRing(&ring);
+    }
+    DestroyFenceRing(&ring);
+*/
+
+#ifndef FENCERING_H
+#define FENCERING_H
+
+#include <glad/gl.h>
+#include <stddef.h>  // size_t
+
+#ifndef FENCERING_MAX_FRAMES
+#define FENCERING_MAX_FRAMES 8
+#endif
+
+typedef struct FenceRing
+{
+    GLuint buffer;
+    unsigned char* persistent;  // The persistent mapping, NULL for a plain buffer.
+    size_t frameSize;
+    int frames;
+    int frame;                  // The region being written.
+    GLsync fences[FENCERING_MAX_FRAMES];
+} FenceRing;
+
+/*! @breif
+    This creates the buffer, persistently mapped when asked for and available.
+	@param[out] The ring.
+	@param[in] The size of one region in bytes, already aligned the way the caller needs.
+	@param[in] The number of regions, up to FENCERING_MAX_FRAMES.
+	@param[in] 1 to try a persistent coherent mapping first.
+	@param[in] The usage for the plain buffer, e.g. GL_STREAM_DRAW.
+	@return 1 on success, 0 otherwise.
+*/
+int  CreateFenceRing(FenceRing* ring, size_t frameSize, int frames, int persistent, GLenum usage);
+
+/*! @breif
+    This waits until the GPU is done with the current region. Normally it finished long ago.
+	@param[in] The ring.
+*/
+void WaitFenceRing(FenceRing* ring);
+
+/*! @breif
+    This puts a fence behind everything that used the current region and moves to the next one.
+	@param[in] The ring.
+*/
+void AdvanceFenceRing(FenceRing* ring);
+void DestroyFenceRing(FenceRing* ring);
+
+#endif // FENCERING_H
+
+#if defined(FENCERING_IMPLEMENTATION) && !defined(FENCERING_IMPLEMENTATION_DONE)
+#define FENCERING_IMPLEMENTATION_DONE
+
+#include <string.h>  // memset()
+#include "logging.h"
+
+int CreateFenceRing(FenceRing* ring, size_t frameSize, int frames, int persistent, GLenum usage)
+{
+    memset(ring, 0, sizeof(FenceRing));
+    if(frames < 1 || frames > FENCERING_MAX_FRAMES)
+    {
+        logError(GL, "A fence ring can have 1 to %d frames, not %d", FENCERING_MAX_FRAMES, frames);
+        return 0;
+    }
+    ring->frameSize = frameSize;
+    ring->frames = frames;
+    GLsizeiptr totalSize = (GLsizeiptr)(frameSize * (size_t)frames);
+
+    glGenBuffers(1, &ring->buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, ring->buffer);
+    if(persistent && (GLAD_GL_VERSION_4_4 || GLAD_GL_ARB_buffer_storage))
+    {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_COPY_WRITE_BUFFER, totalSize, NULL, flags);
+        ring->persistent = (unsigned char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, totalSize, flags);
+        if(ring->persistent == NULL)
+        {
+            // Immutable storage can't be resized, start over with a plain buffer.
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+            glDeleteBuffers(1, &ring->buffer);
+            glGenBuffers(1, &ring->buffer);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, ring->buffer);
+        }
+    }
+    GLint64 size = totalSize;
+    if(ring->persistent == NULL)
+    {
+        glBufferData(GL_COPY_WRITE_BUFFER, totalSize, NULL, usage);
+        // Asked directly, glGetError could still hold an error from some earlier call.
+        glGetBufferParameteri64v(GL_COPY_WRITE_BUFFER, GL_BUFFER_SIZE, &size);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    if(size != totalSize)
+    {
+        logError(GL, "Unable to create a %zu byte ring buffer", (size_t)totalSize);
+        DestroyFenceRing(ring);
+        return 0;
+    }
+    return 1;
+}
+
+void WaitFenceRing(FenceRing* ring)
+{
+    GLsync fence = ring->fences[ring->frame];
+    if(fence)
+    {
+        GLenum result = glClientWaitSync(fence, 0, 0);
+        while(result == GL_TIMEOUT_EXPIRED)
+        {
+            result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+        }
+        glDeleteSync(fence);
+        ring->fences[ring->frame] = NULL;
+    }
+}
+
+void AdvanceFenceRing(FenceRing* ring)
+{
+    ring->fences[ring->frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    ring->frame = (ring->frame + 1) % ring->frames;
+}
+
+void DestroyFenceRing(FenceRing* ring)
+{
+    for(int i = 0; i < FENCERING_MAX_FRAMES; i++)
+    {
+        if(ring->fences[i]){glDeleteSync(ring->fences[i]);}
+    }
+    if(ring->persistent)
+    {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, ring->buffer);
+        glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+    if(ring->buffer){glDeleteBuffers(1, &ring->buffer);}
+    memset(ring, 0, sizeof(FenceRing));
+}
+
+#endif // FENCERING_IMPLEMENTATION
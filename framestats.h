@@ -0,0 +1,344 @@
+/*!
+@author ThatOSDev
+@NOTE
+#define FRAMESTATS_IMPLEMENTATION
+#include "framestats.h"
+
+Frame time statistics. CPU time is measured from BeginFrameStats to EndFrameStats, GPU time with
+a pair of GL_TIMESTAMP queries around the same span that are read back a few frames later. Both go into
+fixed size histograms, so recording costs the same at frame 10 as at frame 10 million.
+The CPU clock is ProfileNow(), so profiler.h needs PROFILER_IMPLEMENTATION somewhere in the program.
+
+EXAMPLE :
+    FrameStats stats;
+    InitFrameStats(&stats);
+    while(...)
+    {
+        BeginFrameStats(&stats);
+        // draw, swap
+        EndFrameStats(&stats);
+    }
+    FinishFrameStats(&stats);                        // Reads back the last GPU times.
+    LogFrameStats(&stats);
+    WriteFrameStats(&stats, "benchmark.json");
+    if(CheckFrameStatsBaseline(&stats, "baseline.json", 0.10) == 0){ regression }
+*/
+
+#ifndef FRAMESTATS_H
+#define FRAMESTATS_H
+
+#include <glad/gl.h>
+
+#ifndef FRAMESTATS_BIN_US
+#define FRAMESTATS_BIN_US 50        // Width of one histogram bin in microseconds.
+#endif
+
+#ifndef FRAMESTATS_BINS
+#define FRAMESTATS_BINS 2000        // 2000 x 50us covers 100 ms, slower frames only count towards max.
+#endif
+
+#ifndef FRAMESTATS_GPU_FRAMES
+#define FRAMESTATS_GPU_FRAMES 4     // GPU queries in flight.
+#endif
+
+typedef struct FrameHistogram
+{
+    unsigned int bins[FRAMESTATS_BINS];
+    unsigned int overflow;
+    long long count;
+    double mean;                    // Running mean and sum of squares (Welford), in ms.
+    double m2;
+    double max;
+} FrameHistogram;
+
+typedef struct FrameTimeSummary
+{
+    long long count;
+    double mean;
+    double variance;
+    double p50;
+    double p95;
+    double p99;
+    double max;
+} FrameTimeSummary;
+
+typedef struct FrameStats
+{
+    FrameHistogram cpu;
+    FrameHistogram gpu;
+    long long frameStart;
+    GLuint queries[FRAMESTATS_GPU_FRAMES][2];  // Begin and end timestamps.
+    int queryUsed[FRAMESTATS_GPU_FRAMES];
+    int frame;
+    int gpuDropped;
+    int hasGpu;
+} FrameStats;
+
+/*! @breif
+    This sets up the stats. Needs a current GL context for the GPU queries.
+	@param[out] The stats.
+*/
+void InitFrameStats(FrameStats* stats);
+void BeginFrameStats(FrameStats* stats);
+void EndFrameStats(FrameStats* stats);
+
+/*! @breif
+    This waits for the GPU times still in flight and deletes the queries.
+	@param[in] The stats.
+*/
+void FinishFrameStats(FrameStats* stats);
+
+/*! @breif
+    This works out the percentiles from a histogram. They are accurate to FRAMESTATS_BIN_US.
+	@param[in] The histogram.
+	@param[out] The summary, all times in ms.
+*/
+void SummarizeFrameTimes(const FrameHistogram* histogram, FrameTimeSummary* summary);
+
+void LogFrameStats(FrameStats* stats);
+
+/*! @breif
+    This saves the CPU and GPU summaries as JSON.
+	@param[in] The stats.
+	@param[in] This is the path and name of the file to save.
+	@return 1 on success, 0 otherwise.
+*/
+int WriteFrameStats(FrameStats* stats, const char* fileName);
+
+/*! @breif
+    This compares p50 and p95 against a file written by WriteFrameStats earlier.
+	@param[in] The stats.
+	@param[in] The baseline JSON.
+	@param[in] How much slower is still fine, 0.10 is 10%.
+	@return 1 if nothing got slower, 0 on a regression, -1 if the baseline can't be read.
+*/
+int CheckFrameStatsBaseline(FrameStats* stats, const char* baselineFile, double tolerance);
+
+#endif // FRAMESTATS_H
+
+#if defined(FRAMESTATS_IMPLEMENTATION) && !defined(FRAMESTATS_IMPLEMENTATION_DONE)
+#define FRAMESTATS_IMPLEMENTATION_DONE
+
+#include <stdio.h>   // fopen()  fprintf()
+#include <stdlib.h>  // malloc()  strtod()
+#include <string.h>  // memset()  strstr()
+#include "logging.h"
+#include "profiler.h"  // ProfileNow()
+
+static void frameHistogramAdd(FrameHistogram* h, double ms)
+{
+    long long bin = (long long)(ms * 1000.0 / FRAMESTATS_BIN_US);
+    if(bin < 0){bin = 0;}
+    if(bin < FRAMESTATS_BINS)
+    {
+        h->bins[bin]++;
+    } else {
+        h->overflow++;
+    }
+    h->count++;
+    double delta = ms - h->mean;
+    h->mean += delta / (double)h->count;
+    h->m2 += delta * (ms - h->mean);
+    if(ms > h->max){h->max = ms;}
+}
+
+void InitFrameStats(FrameStats* stats)
+{
+    memset(stats, 0, sizeof(FrameStats));
+    stats->hasGpu = GLAD_GL_VERSION_3_3 || GLAD_GL_ARB_timer_query;
+    if(stats->hasGpu){glGenQueries(FRAMESTATS_GPU_FRAMES * 2, &stats->queries[0][0]);}
+}
+
+static void frameStatsReadGpu(FrameStats* stats, int index, int wait)
+{
+    if(!stats->queryUsed[index]){return;}
+    GLint available = 1;
+    if(!wait){glGetQueryObjectiv(stats->queries[index][1], GL_QUERY_RESULT_AVAILABLE, &available);}
+    if(available)
+    {
+        GLuint64 begin = 0, end = 0;
+        glGetQueryObjectui64v(stats->queries[index][0], GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(stats->queries[index][1], GL_QUERY_RESULT, &end);
+        frameHistogramAdd(&stats->gpu, (end > begin) ? (double)(end - begin) / 1000000.0 : 0.0);
+    } else {
+        stats->gpuDropped++;  // Never wait on the GPU mid run, the frame just isn't counted.
+    }
+    stats->queryUsed[index] = 0;
+}
+
+void BeginFrameStats(FrameStats* stats)
+{
+    stats->frameStart = ProfileNow();
+    if(stats->hasGpu)
+    {
+        int index = stats->frame % FRAMESTATS_GPU_FRAMES;
+        frameStatsReadGpu(stats, index, 0);
+        glQueryCounter(stats->queries[index][0], GL_TIMESTAMP);
+    }
+}
+
+void EndFrameStats(FrameStats* stats)
+{
+    if(stats->hasGpu)
+    {
+        glQueryCounter(stats->queries[stats->frame % FRAMESTATS_GPU_FRAMES][1], GL_TIMESTAMP);
+        stats->queryUsed[stats->frame % FRAMESTATS_GPU_FRAMES] = 1;
+        glFlush(); // Headless runs never swap, this gets the query to the GPU.
+    }
+    frameHistogramAdd(&stats->cpu, (double)(ProfileNow() - stats->frameStart) / 1000000.0);
+    stats->frame++;
+}
+
+void FinishFrameStats(FrameStats* stats)
+{
+    if(!stats->hasGpu){return;}
+    for(int i = 0; i < FRAMESTATS_GPU_FRAMES; i++)
+    {
+        frameStatsReadGpu(stats, (stats->frame + i) % FRAMESTATS_GPU_FRAMES, 1);
+    }
+    glDeleteQueries(FRAMESTATS_GPU_FRAMES * 2, &stats->queries[0][0]);
+    stats->hasGpu = 0;
+}
+
+static double frameHistogramPercentile(const FrameHistogram* h, double percent)
+{
+    long long rank = (long long)(percent * (double)h->count + 0.999999);
+    if(rank < 1){rank = 1;}
+    long long seen = 0;
+    for(int i = 0; i < FRAMESTATS_BINS; i++)
+    {
+        seen += h->bins[i];
+        if(seen >= rank)
+        {
+            double ms = (i + 0.5) * FRAMESTATS_BIN_US / 1000.0;
+            return (ms < h->max) ? ms : h->max;
+        }
+    }
+    return h->max;
+}
+
+void SummarizeFrameTimes(const FrameHistogram* histogram, FrameTimeSummary* summary)
+{
+    memset(summary, 0, sizeof(FrameTimeSummary));
+    summary->count = histogram->count;
+    if(histogram->count == 0){return;}
+    summary->mean = histogram->mean;
+    summary->variance = (histogram->count > 1) ? histogram->m2 / (double)(histogram->count - 1) : 0.0;
+    summary->p50 = frameHistogramPercentile(histogram, 0.50);
+    summary->p95 = frameHistogramPercentile(histogram, 0.95);
+    summary->p99 = frameHistogramPercentile(histogram, 0.99);
+    summary->max = histogram->max;
+}
+
+void LogFrameStats(FrameStats* stats)
+{
+    FrameTimeSummary cpu, gpu;
+    SummarizeFrameTimes(&stats->cpu, &cpu);
+    SummarizeFrameTimes(&stats->gpu, &gpu);
+    logInfo(GL, "Frame CPU ms : %lld frames  p50 %.3f  p95 %.3f  p99 %.3f  max %.3f  variance %.4f",
+            cpu.count, cpu.p50, cpu.p95, cpu.p99, cpu.max, cpu.variance);
+    logInfo(GL, "Frame GPU ms : %lld frames  p50 %.3f  p95 %.3f  p99 %.3f  max %.3f  variance %.4f  (%d not ready in time)",
+            gpu.count, gpu.p50, gpu.p95, gpu.p99, gpu.max, gpu.variance, stats->gpuDropped);
+}
+
+static void frameStatsWriteSummary(FILE* file, const char* name, const FrameTimeSummary* s)
+{
+    fprintf(file, "  \"%s\": {\"frames\": %lld, \"mean\": %.4f, \"variance\": %.6f, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f}",
+            name, s->count, s->mean, s->variance, s->p50, s->p95, s->p99, s->max);
+}
+
+// Driver strings can hold anything, so quotes, backslashes and control characters are escaped.
+static void frameStatsWriteString(FILE* file, const char* text)
+{
+    fputc('"', file);
+    for(const unsigned char* c = (const unsigned char*)(text ? text : ""); *c; c++)
+    {
+        if(*c == '"' || *c == '\\')
+        {
+            fputc('\\', file);
+            fputc(*c, file);
+        } else if(*c < 0x20) {
+            fprintf(file, "\\u%04x", *c);
+        } else {
+            fputc(*c, file);
+        }
+    }
+    fputc('"', file);
+}
+
+int WriteFrameStats(FrameStats* stats, const char* fileName)
+{
+    FILE* file = fopen(fileName, "w");
+    if(file == NULL)
+    {
+        logError(GL, "Unable to write frame stats : %s", fileName);
+        return 0;
+    }
+    FrameTimeSummary cpu, gpu;
+    SummarizeFrameTimes(&stats->cpu, &cpu);
+    SummarizeFrameTimes(&stats->gpu, &gpu);
+
+    fprintf(file, "{\n");
+    fprintf(file, "  \"renderer\": ");
+    frameStatsWriteString(file, (const char*)glGetString(GL_RENDERER));
+    fprintf(file, ",\n");
+    frameStatsWriteSummary(file, "cpu", &cpu);
+    fprintf(file, ",\n");
+    frameStatsWriteSummary(file, "gpu", &gpu);
+    fprintf(file, "\n}\n");
+    return fclose(file) == 0;
+}
+
+static double frameStatsFind(const char* json, const char* section, const char* key)
+{
+    // Only reads what WriteFrameStats writes.
+    char pattern[64];
+    snprintf(pattern, sizeof(pattern), "\"%s\"", section);
+    const char* p = strstr(json, pattern);
+    if(p == NULL){return -1.0;}
+    snprintf(pattern, sizeof(pattern), "\"%s\":", key);
+    p = strstr(p, pattern);
+    if(p == NULL){return -1.0;}
+    return strtod(p + strlen(pattern), NULL);
+}
+
+static int frameStatsCompare(const char* name, double now, double baseline, double tolerance)
+{
+    if(baseline <= 0.0){return 1;}  // Not in the baseline, or too fast to measure.
+    if(now > baseline * (1.0 + tolerance))
+    {
+        logWarn(GL, "Benchmark regression : %s %.4f ms, baseline %.4f ms", name, now, baseline);
+        return 0;
+    }
+    return 1;
+}
+
+int CheckFrameStatsBaseline(FrameStats* stats, const char* baselineFile, double tolerance)
+{
+    FILE* file = fopen(baselineFile, "rb");
+    if(file == NULL)
+    {
+        logError(GL, "Unable to open the benchmark baseline : %s", baselineFile);
+        return -1;
+    }
+    char json[4096];
+    size_t length = fread(json, 1, sizeof(json) - 1, file);
+    json[length] = '\0';
+    fclose(file);
+
+    FrameTimeSummary cpu, gpu;
+    SummarizeFrameTimes(&stats->cpu, &cpu);
+    SummarizeFrameTimes(&stats->gpu, &gpu);
+
+    int ok = 1;
+    ok &= frameStatsCompare("cpu p50", cpu.p50, frameStatsFind(json, "cpu", "p50"), tolerance);
+    ok &= frameStatsCompare("cpu p95", cpu.p95, frameStatsFind(json, "cpu", "p95"), tolerance);
+    if(gpu.count > 0)
+    {
+        ok &= frameStatsCompare("gpu p50", gpu.p50, frameStatsFind(json, "gpu", "p50"), tolerance);
+        ok &= frameStatsCompare("gpu p95", gpu.p95, frameStatsFind(json, "gpu", "p95"), tolerance);
+    }
+    return ok;
+}
+
+#endif // FRAMESTATS_IMPLEMENTATION
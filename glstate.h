@@ -0,0 +1,325 @@
+/*!
+@author ThatOSDev
+@NOTE
+#define GLSTATE_IMPLEMENTATION
+#include "glstate.h"
+
+Remembers the GL state it sets and skips calls that would set the same thing again. It only
+knows about what goes through it, so code that calls glBindVertexArray etc. directly has to
+call InvalidateState() afterwards. Deleting through StateDelete... keeps it right when GL
+hands out a deleted name again. The cache and its counters are per thread, like a current context.
+
+Shadowed : the program, the VAO, GL_ARRAY_BUFFER, GL_ELEMENT_ARRAY_BUFFER, GL_DRAW_INDIRECT_BUFFER,
+2D / 2D array / cube / 3D textures on the first STATE_TEXTURE_UNITS units, GL_BLEND, GL_DEPTH_TEST,
+GL_CULL_FACE, GL_SCISSOR_TEST, the blend and depth functions, the depth mask and the viewport.
+Anything else passes straight through and counts as issued.
+
+EXAMPLE :
+    StateUseProgram(shaderProgram);
+    StateBindVertexArray(VAO);
+    StateBindTexture(0, GL_TEXTURE_2D, texture);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+
+    GLStateStats stats;
+    GetStateStats(&stats);          // issued / skipped since the last ResetStateStats()
+*/
+
+#ifndef GLSTATE_H
+#define GLSTATE_H
+
+#include <glad/gl.h>
+
+#ifndef STATE_TEXTURE_UNITS
+#define STATE_TEXTURE_UNITS 16
+#endif
+
+typedef struct GLStateStats
+{
+    unsigned long long issued;   // Calls that went to GL.
+    unsigned long long skipped;  // Calls that would not have changed anything.
+} GLStateStats;
+
+void StateUseProgram(GLuint program);
+void StateBindVertexArray(GLuint vao);
+void StateBindBuffer(GLenum target, GLuint buffer);
+
+/*! @breif
+    This binds a texture to a unit, switching the active unit only when it has to.
+	@param[in] The texture unit, 0 for GL_TEXTURE0.
+	@param[in] The target, e.g. GL_TEXTURE_2D.
+	@param[in] The texture.
+*/
+void StateBindTexture(GLuint unit, GLenum target, GLuint texture);
+void StateEnable(GLenum cap);
+void StateDisable(GLenum cap);
+void StateBlendFunc(GLenum source, GLenum destination);
+void StateDepthFunc(GLenum func);
+void StateDepthMask(GLboolean mask);
+void StateViewport(GLint x, GLint y, GLsizei width, GLsizei height);
+
+void StateDeleteProgram(GLuint program);
+void StateDeleteVertexArrays(GLsizei count, const GLuint* vaos);
+void StateDeleteBuffers(GLsizei count, const GLuint* buffers);
+void StateDeleteTextures(GLsizei count, const GLuint* textures);
+
+/*! @breif
+    This forgets everything, the next call of each kind goes to GL. Use after GL was called directly.
+*/
+void InvalidateState(void);
+void GetStateStats(GLStateStats* stats);
+void ResetStateStats(void);
+
+#endif // GLSTATE_H
+
+#if defined(GLSTATE_IMPLEMENTATION) && !defined(GLSTATE_IMPLEMENTATION_DONE)
+#define GLSTATE_IMPLEMENTATION_DONE
+
+#ifdef _MSC_VER
+#define GLSTATE_THREAD_LOCAL __declspec(thread)
+#else
+#define GLSTATE_THREAD_LOCAL __thread
+#endif
+
+#define STATE_UNKNOWN 0xFFFFFFFFu
+#define STATE_BUFFER_TARGETS  3
+#define STATE_TEXTURE_TARGETS 4
+#define STATE_CAPS            4
+
+typedef struct GLStateCache
+{
+    GLuint program;
+    GLuint vao;
+    GLuint buffers[STATE_BUFFER_TARGETS];
+    GLuint activeUnit;
+    GLuint textures[STATE_TEXTURE_UNITS][STATE_TEXTURE_TARGETS];
+    GLuint caps[STATE_CAPS];     // 0, 1 or STATE_UNKNOWN
+    GLuint blendSource;
+    GLuint blendDestination;
+    GLuint depthFunc;
+    GLuint depthMask;
+    GLint viewport[4];
+    int viewportKnown;
+} GLStateCache;
+
+static GLSTATE_THREAD_LOCAL GLStateCache glState;
+static GLSTATE_THREAD_LOCAL int glStateReady = 0;
+static GLSTATE_THREAD_LOCAL GLStateStats glStateStats;
+
+static const GLenum stateBufferTargets[STATE_BUFFER_TARGETS] = {GL_ARRAY_BUFFER, GL_ELEMENT_ARRAY_BUFFER, GL_DRAW_INDIRECT_BUFFER};
+static const GLenum stateTextureTargets[STATE_TEXTURE_TARGETS] = {GL_TEXTURE_2D, GL_TEXTURE_2D_ARRAY, GL_TEXTURE_CUBE_MAP, GL_TEXTURE_3D};
+static const GLenum stateCaps[STATE_CAPS] = {GL_BLEND, GL_DEPTH_TEST, GL_CULL_FACE, GL_SCISSOR_TEST};
+
+static int stateIndex(const GLenum* table, int count, GLenum value)
+{
+    for(int i = 0; i < count; i++)
+    {
+        if(table[i] == value){return i;}
+    }
+    return -1;
+}
+
+// Returns 1 when the call has to go to GL, and remembers the new value.
+static int stateChange(GLuint* shadow, GLuint value)
+{
+    if(!glStateReady){InvalidateState();}
+    if(*shadow == value)
+    {
+        glStateStats.skipped++;
+        return 0;
+    }
+    *shadow = value;
+    glStateStats.issued++;
+    return 1;
+}
+
+void InvalidateState(void)
+{
+    glState.program = STATE_UNKNOWN;
+    glState.vao = STATE_UNKNOWN;
+    glState.activeUnit = STATE_UNKNOWN;
+    for(int i = 0; i < STATE_BUFFER_TARGETS; i++){glState.buffers[i] = STATE_UNKNOWN;}
+    for(int u = 0; u < STATE_TEXTURE_UNITS; u++)
+    {
+        for(int t = 0; t < STATE_TEXTURE_TARGETS; t++){glState.textures[u][t] = STATE_UNKNOWN;}
+    }
+    for(int i = 0; i < STATE_CAPS; i++){glState.caps[i] = STATE_UNKNOWN;}
+    glState.blendSource = STATE_UNKNOWN;
+    glState.blendDestination = STATE_UNKNOWN;
+    glState.depthFunc = STATE_UNKNOWN;
+    glState.depthMask = STATE_UNKNOWN;
+    glState.viewportKnown = 0;
+    glStateReady = 1;
+}
+
+void StateUseProgram(GLuint program)
+{
+    if(stateChange(&glState.program, program)){glUseProgram(program);}
+}
+
+void StateBindVertexArray(GLuint vao)
+{
+    if(stateChange(&glState.vao, vao))
+    {
+        glBindVertexArray(vao);
+        glState.buffers[1] = STATE_UNKNOWN;  // The element buffer belongs to the VAO.
+    }
+}
+
+void StateBindBuffer(GLenum target, GLuint buffer)
+{
+    int index = stateIndex(stateBufferTargets, STATE_BUFFER_TARGETS, target);
+    if(index < 0)
+    {
+        glStateStats.issued++;
+        glBindBuffer(target, buffer);
+        return;
+    }
+    if(stateChange(&glState.buffers[index], buffer)){glBindBuffer(target, buffer);}
+}
+
+void StateBindTexture(GLuint unit, GLenum target, GLuint texture)
+{
+    int index = stateIndex(stateTextureTargets, STATE_TEXTURE_TARGETS, target);
+    if(index < 0 || unit >= STATE_TEXTURE_UNITS)
+    {
+        glStateStats.issued += 2;
+        glActiveTexture(GL_TEXTURE0 + unit);
+        glBindTexture(target, texture);
+        glState.activeUnit = unit;
+        return;
+    }
+    if(!glStateReady){InvalidateState();}
+    if(glState.textures[unit][index] == texture)
+    {
+        glStateStats.skipped++;
+        return;
+    }
+    // Only switched on the way to a real bind, so it counts as issued but never as skipped.
+    if(glState.activeUnit != unit)
+    {
+        glState.activeUnit = unit;
+        glStateStats.issued++;
+        glActiveTexture(GL_TEXTURE0 + unit);
+    }
+    glState.textures[unit][index] = texture;
+    glStateStats.issued++;
+    glBindTexture(target, texture);
+}
+
+static void stateSetCap(GLenum cap, GLuint enabled)
+{
+    int index = stateIndex(stateCaps, STATE_CAPS, cap);
+    if(index >= 0 && !stateChange(&glState.caps[index], enabled)){return;}
+    if(index < 0){glStateStats.issued++;}
+    if(enabled)
+    {
+        glEnable(cap);
+    } else {
+        glDisable(cap);
+    }
+}
+
+void StateEnable(GLenum cap)  { stateSetCap(cap, 1); }
+void StateDisable(GLenum cap) { stateSetCap(cap, 0); }
+
+void StateBlendFunc(GLenum source, GLenum destination)
+{
+    if(!glStateReady){InvalidateState();}
+    if(glState.blendSource == source && glState.blendDestination == destination)
+    {
+        glStateStats.skipped++;
+        return;
+    }
+    glState.blendSource = source;
+    glState.blendDestination = destination;
+    glStateStats.issued++;
+    glBlendFunc(source, destination);
+}
+
+void StateDepthFunc(GLenum func)
+{
+    if(stateChange(&glState.depthFunc, func)){glDepthFunc(func);}
+}
+
+void StateDepthMask(GLboolean mask)
+{
+    if(stateChange(&glState.depthMask, mask ? 1 : 0)){glDepthMask(mask);}
+}
+
+void StateViewport(GLint x, GLint y, GLsizei width, GLsizei height)
+{
+    if(!glStateReady){InvalidateState();}
+    if(glState.viewportKnown && glState.viewport[0] == x && glState.viewport[1] == y && glState.viewport[2] == width && glState.viewport[3] == height)
+    {
+        glStateStats.skipped++;
+        return;
+    }
+    glState.viewport[0] = x;
+    glState.viewport[1] = y;
+    glState.viewport[2] = width;
+    glState.viewport[3] = height;
+    glState.viewportKnown = 1;
+    glStateStats.issued++;
+    glViewport(x, y, width, height);
+}
+
+// A deleted program stays in use until the next glUseProgram, but its name can come back.
+void StateDeleteProgram(GLuint program)
+{
+    if(glState.program == program){glState.program = STATE_UNKNOWN;}
+    glDeleteProgram(program);
+}
+
+// Deleting a bound object binds 0 in its place.
+void StateDeleteVertexArrays(GLsizei count, const GLuint* vaos)
+{
+    for(GLsizei i = 0; i < count; i++)
+    {
+        if(glState.vao == vaos[i])
+        {
+            glState.vao = 0;
+            glState.buffers[1] = STATE_UNKNOWN;
+        }
+    }
+    glDeleteVertexArrays(count, vaos);
+}
+
+void StateDeleteBuffers(GLsizei count, const GLuint* buffers)
+{
+    for(GLsizei i = 0; i < count; i++)
+    {
+        for(int t = 0; t < STATE_BUFFER_TARGETS; t++)
+        {
+            if(glState.buffers[t] == buffers[i]){glState.buffers[t] = 0;}
+        }
+    }
+    glDeleteBuffers(count, buffers);
+}
+
+void StateDeleteTextures(GLsizei count, const GLuint* textures)
+{
+    for(GLsizei i = 0; i < count; i++)
+    {
+        for(int u = 0; u < STATE_TEXTURE_UNITS; u++)
+        {
+            for(int t = 0; t < STATE_TEXTURE_TARGETS; t++)
+            {
+                if(glState.textures[u][t] == textures[i]){glState.textures[u][t] = 0;}
+            }
+        }
+    }
+    glDeleteTextures(count, textures);
+}
+
+void GetStateStats(GLStateStats* stats)
+{
+    *stats = glStateStats;
+}
+
+void ResetStateStats(void)
+{
+    glStateStats.issued = 0;
+    glStateStats.skipped = 0;
+}
+
+#endif // GLSTATE_IMPLEMENTATION
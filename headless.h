@@ -0,0 +1,226 @@
+/*!
+@author ThatOSDev
+@NOTE
+#define HEADLESS_IMPLEMENTATION
+#include "headless.h"
+
+Renders without a window through an EGL surfaceless context (Mesa llvmpipe works fine).
+Add libs/glad/src/egl.c to the project. libEGL is loaded at runtime, there is nothing to link.
+
+EXAMPLE :
+    Headless headless;
+    if(StartHeadless(&headless, 640, 480))
+    {
+        // draw, everything lands in the headless framebuffer
+        SaveHeadlessFrame(&headless, "frame.bmp");
+        StopHeadless(&headless);
+    }
+*/
+
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include <glad/egl.h>
+#include <glad/gl.h>
+
+typedef struct Headless
+{
+    EGLDisplay display;
+    EGLConfig config;
+    EGLContext context;
+    GLuint fbo;
+    GLuint color;
+    GLuint depth;
+    int width;
+    int height;
+} Headless;
+
+/*! @breif
+    This creates a GL 3.3 core context with no window, loads GL through glad and binds
+    a framebuffer of the given size with color and depth.
+	@param[out] The headless context.
+	@param[in] The Width of the framebuffer.
+	@param[in] The Height of the framebuffer.
+	@return 1 on success, 0 otherwise.
+*/
+int StartHeadless(Headless* headless, int width, int height);
+
+/*! @breif
+    This reads back the headless framebuffer and saves it as a 32 Bit BMP.
+	@param[in] The headless context.
+	@param[in] This is the path and name of the file to save.
+*/
+void SaveHeadlessFrame(Headless* headless, const char* fileName);
+
+/*! @breif
+    This creates another context that shares objects with the headless one, for a loader thread.
+	@param[in] The headless context.
+	@return The new context, EGL_NO_CONTEXT on failure.
+*/
+EGLContext CreateHeadlessSharedContext(Headless* headless);
+
+/*! @breif
+    This makes a context current on the calling thread, with no surface.
+	@param[in] The headless context.
+	@param[in] The context, EGL_NO_CONTEXT to release the current one.
+	@return 1 on success, 0 otherwise.
+*/
+int MakeHeadlessContextCurrent(Headless* headless, EGLContext context);
+void DestroyHeadlessSharedContext(Headless* headless, EGLContext context);
+
+/*! @breif
+    This destroys the framebuffer and the context.
+	@param[in] The headless context.
+*/
+void StopHeadless(Headless* headless);
+
+#endif // HEADLESS_H
+
+#if defined(HEADLESS_IMPLEMENTATION) && !defined(HEADLESS_IMPLEMENTATION_DONE)
+#define HEADLESS_IMPLEMENTATION_DONE
+
+#include <stdlib.h>  // malloc()  free()
+#include <string.h>  // memset()
+#include "bmp.h"
+#include "logging.h"
+
+static const EGLint headlessContextAttribs[] = {
+    EGL_CONTEXT_MAJOR_VERSION, 3,
+    EGL_CONTEXT_MINOR_VERSION, 3,
+    EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+    EGL_NONE
+};
+
+static EGLDisplay headlessGetDisplay(void)
+{
+    // Prefer Mesa's surfaceless platform, it needs no X11, Wayland or GPU.
+    if(GLAD_EGL_EXT_platform_base)
+    {
+        EGLDisplay display = eglGetPlatformDisplayEXT(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+        if(display != EGL_NO_DISPLAY){return display;}
+    }
+    return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+}
+
+int StartHeadless(Headless* headless, int width, int height)
+{
+    memset(headless, 0, sizeof(Headless));
+
+    if(!gladLoaderLoadEGL(EGL_NO_DISPLAY))
+    {
+        logError(GL, "Unable to load libEGL");
+        return 0;
+    }
+
+    headless->display = headlessGetDisplay();
+    if(headless->display == EGL_NO_DISPLAY || !eglInitialize(headless->display, NULL, NULL))
+    {
+        logError(GL, "Unable to initialize an EGL display");
+        return 0;
+    }
+    gladLoaderLoadEGL(headless->display); // Picks up the display extensions.
+
+    EGLint configAttribs[] = {EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE};
+    EGLConfig config = NULL;
+    EGLint configCount = 0;
+    eglChooseConfig(headless->display, configAttribs, &config, 1, &configCount);
+    headless->config = configCount ? config : NULL;
+
+    eglBindAPI(EGL_OPENGL_API);
+    headless->context = eglCreateContext(headless->display, headless->config, EGL_NO_CONTEXT, headlessContextAttribs);
+    if(headless->context == EGL_NO_CONTEXT || !eglMakeCurrent(headless->display, EGL_NO_SURFACE, EGL_NO_SURFACE, headless->context))
+    {
+        logError(GL, "Unable to create a surfaceless GL 3.3 context");
+        StopHeadless(headless);
+        return 0;
+    }
+
+    if(!gladLoadGL((GLADloadfunc)eglGetProcAddress))
+    {
+        logError(GL, "Unable to load GL for the headless context");
+        StopHeadless(headless);
+        return 0;
+    }
+
+    headless->width = width;
+    headless->height = height;
+
+    glGenRenderbuffers(1, &headless->color);
+    glBindRenderbuffer(GL_RENDERBUFFER, headless->color);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glGenRenderbuffers(1, &headless->depth);
+    glBindRenderbuffer(GL_RENDERBUFFER, headless->depth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &headless->fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, headless->fbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, headless->color);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, headless->depth);
+    if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        logError(GL, "Headless framebuffer is incomplete");
+        StopHeadless(headless);
+        return 0;
+    }
+    glViewport(0, 0, width, height);
+
+    logInfo(GL, "Headless %s / %s", glGetString(GL_RENDERER), glGetString(GL_VERSION));
+    return 1;
+}
+
+void SaveHeadlessFrame(Headless* headless, const char* fileName)
+{
+    unsigned char* pixels = malloc((size_t)headless->width * headless->height * 4);
+    if(pixels == NULL){return;}
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, headless->fbo);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, headless->width, headless->height, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    SaveBMP(fileName, pixels, headless->width, headless->height, 32);
+    free(pixels);
+}
+
+EGLContext CreateHeadlessSharedContext(Headless* headless)
+{
+    eglBindAPI(EGL_OPENGL_API);
+    EGLContext context = eglCreateContext(headless->display, headless->config, headless->context, headlessContextAttribs);
+    if(context == EGL_NO_CONTEXT)
+    {
+        logError(GL, "Unable to create a shared GL 3.3 context");
+    }
+    return context;
+}
+
+// The bound API is per thread in EGL, so it is set again here for loader threads.
+int MakeHeadlessContextCurrent(Headless* headless, EGLContext context)
+{
+    eglBindAPI(EGL_OPENGL_API);
+    if(!eglMakeCurrent(headless->display, EGL_NO_SURFACE, EGL_NO_SURFACE, context))
+    {
+        logError(GL, "Unable to make a headless context current");
+        return 0;
+    }
+    return 1;
+}
+
+void DestroyHeadlessSharedContext(Headless* headless, EGLContext context)
+{
+    if(context != EGL_NO_CONTEXT){eglDestroyContext(headless->display, context);}
+}
+
+void StopHeadless(Headless* headless)
+{
+    if(headless->fbo){glDeleteFramebuffers(1, &headless->fbo);}
+    if(headless->color){glDeleteRenderbuffers(1, &headless->color);}
+    if(headless->depth){glDeleteRenderbuffers(1, &headless->depth);}
+    if(headless->display != EGL_NO_DISPLAY)
+    {
+        eglMakeCurrent(headless->display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        if(headless->context != EGL_NO_CONTEXT){eglDestroyContext(headless->display, headless->context);}
+        eglTerminate(headless->display);
+    }
+    gladLoaderUnloadEGL();
+    memset(headless, 0, sizeof(Headless));
+}
+
+#endif // HEADLESS_IMPLEMENTATION
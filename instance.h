@@ -0,0 +1,190 @@
+/*!
+@author ThatOSDev
+@NOTE
+#define INSTANCE_IMPLEMENTATION
+#include "instance.h"
+
+Draws many copies of one mesh in a single call. Each copy gets a transform and a color from a
+per-instance buffer attached to the mesh VAO with glVertexAttribDivisor.
+
+The transform takes 4 attribute locations, starting at INSTANCE_ATTRIB_TRANSFORM.
+    // GLSL :  layout (location = 2) in mat4 aTransform;
+    //         layout (location = 6) in vec4 aInstanceColor;
+
+EXAMPLE :
+    InstanceBatch batch;
+    CreateInstanceBatch(&batch, VAO, GL_TRIANGLES, 3, 0, 10000);   // 0 = glDrawArrays, or GL_UNSIGNED_INT etc.
+    while(...)
+    {
+        ClearInstances(&batch);
+        for(...) { AddInstance(&batch, transform, color); }
+        DrawInstances(&batch);
+    }
+    DestroyInstanceBatch(&batch);
+*/
+
+#ifndef INSTANCE_H
+#define INSTANCE_H
+
+#include <glad/gl.h>
+#include <cglm/cglm.h>
+#include <stddef.h>  // offsetof()
+
+#ifndef INSTANCE_ATTRIB_TRANSFORM
+#define INSTANCE_ATTRIB_TRANSFORM 2  // Uses this location and the 3 after it.
+#endif
+
+#ifndef INSTANCE_ATTRIB_COLOR
+#define INSTANCE_ATTRIB_COLOR 6
+#endif
+
+typedef struct InstanceData
+{
+    mat4 transform;
+    vec4 color;
+} InstanceData;
+
+typedef struct InstanceBatch
+{
+    GLuint vao;           // The mesh VAO, not owned.
+    GLuint buffer;        // Per-instance data.
+    InstanceData* data;   // CPU copy, uploaded by DrawInstances.
+    int count;
+    int capacity;
+    GLenum mode;
+    GLsizei vertexCount;  // Or the index count when indexType is set.
+    GLenum indexType;     // 0 for glDrawArraysInstanced.
+} InstanceBatch;
+
+/*! @breif
+    This adds the per-instance attributes to a mesh VAO.
+	@param[out] The batch.
+	@param[in] The mesh VAO, its vertex attributes must already be set up.
+	@param[in] The primitive, e.g. GL_TRIANGLES.
+	@param[in] The number of vertices, or indices for an indexed mesh.
+	@param[in] The index type (GL_UNSIGNED_INT ...) of the VAO's element buffer, 0 if it has none.
+	@param[in] The most instances drawn at once.
+	@return 1 on success, 0 otherwise.
+*/
+int  CreateInstanceBatch(InstanceBatch* batch, GLuint vao, GLenum mode, GLsizei vertexCount, GLenum indexType, int capacity);
+
+/*! @breif
+    This queues one copy of the mesh.
+	@return The index of the instance, -1 when the batch is full.
+*/
+int  AddInstance(InstanceBatch* batch, const mat4 transform, const vec4 color);
+void ClearInstances(InstanceBatch* batch);
+
+/*! @breif
+    This uploads the queued instances and draws them all in one call. The program must be bound.
+	@param[in] The batch.
+*/
+void DrawInstances(InstanceBatch* batch);
+
+/*! @breif
+    This only uploads, for when something else draws from the VAO (e.g. batch.h with baseInstance).
+	@param[in] The batch.
+*/
+void UploadInstances(InstanceBatch* batch);
+void DestroyInstanceBatch(InstanceBatch* batch);
+
+#endif // INSTANCE_H
+
+#if defined(INSTANCE_IMPLEMENTATION) && !defined(INSTANCE_IMPLEMENTATION_DONE)
+#define INSTANCE_IMPLEMENTATION_DONE
+
+#include <stdlib.h>  // malloc()  free()
+#include <string.h>  // memcpy()  memset()
+#include "profiler.h"
+#include "glstate.h"
+#include "logging.h"
+
+int CreateInstanceBatch(InstanceBatch* batch, GLuint vao, GLenum mode, GLsizei vertexCount, GLenum indexType, int capacity)
+{
+    memset(batch, 0, sizeof(InstanceBatch));
+    batch->data = (InstanceData*)malloc(sizeof(InstanceData) * (size_t)capacity);
+    if(batch->data == NULL)
+    {
+        logError(GL, "Unable to allocate %d instances", capacity);
+        return 0;
+    }
+    batch->vao = vao;
+    batch->capacity = capacity;
+    batch->mode = mode;
+    batch->vertexCount = vertexCount;
+    batch->indexType = indexType;
+
+    glGenBuffers(1, &batch->buffer);
+    StateBindVertexArray(vao);
+    StateBindBuffer(GL_ARRAY_BUFFER, batch->buffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(InstanceData) * (GLsizeiptr)capacity, NULL, GL_STREAM_DRAW);
+
+    // A mat4 attribute is 4 vec4 columns, one location each.
+    for(int c = 0; c < 4; c++)
+    {
+        GLuint location = INSTANCE_ATTRIB_TRANSFORM + c;
+        glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)(offsetof(InstanceData, transform) + sizeof(vec4) * c));
+        glEnableVertexAttribArray(location);
+        glVertexAttribDivisor(location, 1);
+    }
+    glVertexAttribPointer(INSTANCE_ATTRIB_COLOR, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData), (void*)offsetof(InstanceData, color));
+    glEnableVertexAttribArray(INSTANCE_ATTRIB_COLOR);
+    glVertexAttribDivisor(INSTANCE_ATTRIB_COLOR, 1);
+
+    StateBindVertexArray(0);
+    StateBindBuffer(GL_ARRAY_BUFFER, 0);
+    return 1;
+}
+
+int AddInstance(InstanceBatch* batch, const mat4 transform, const vec4 color)
+{
+    if(batch->count >= batch->capacity)
+    {
+        logError(GL, "Instance batch is full (%d)", batch->capacity);
+        return -1;
+    }
+    InstanceData* instance = &batch->data[batch->count];
+    memcpy(instance->transform, transform, sizeof(mat4));
+    memcpy(instance->color, color, sizeof(vec4));
+    return batch->count++;
+}
+
+void ClearInstances(InstanceBatch* batch)
+{
+    batch->count = 0;
+}
+
+void UploadInstances(InstanceBatch* batch)
+{
+    if(batch->count == 0){return;}
+
+    // Orphan the old storage so the upload never waits on last frame's draw.
+    StateBindBuffer(GL_ARRAY_BUFFER, batch->buffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(InstanceData) * (GLsizeiptr)batch->capacity, NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(InstanceData) * (GLsizeiptr)batch->count, batch->data);
+}
+
+void DrawInstances(InstanceBatch* batch)
+{
+    if(batch->count == 0){return;}
+    PROFILE_BEGIN("DrawInstances");
+
+    UploadInstances(batch);
+    StateBindVertexArray(batch->vao);
+    if(batch->indexType)
+    {
+        glDrawElementsInstanced(batch->mode, batch->vertexCount, batch->indexType, NULL, batch->count);
+    } else {
+        glDrawArraysInstanced(batch->mode, 0, batch->vertexCount, batch->count);
+    }
+    PROFILE_END("DrawInstances");
+}
+
+void DestroyInstanceBatch(InstanceBatch* batch)
+{
+    if(batch->buffer){StateDeleteBuffers(1, &batch->buffer);}
+    free(batch->data);
+    memset(batch, 0, sizeof(InstanceBatch));
+}
+
+#endif // INSTANCE_IMPLEMENTATION
@@ -1,4 +1,3 @@
-
 /*
 NOTE - Make sure to define it like this :
 
@@ -6,59 +5,1129 @@ NOTE - Make sure to define it like this :
 #include "logging.h"
 
 EXAMPLE : logging("INFO : Hello there!");
+          logError(SHADER, "Unable to open shader file : %s", fileName);   // ERROR : SHADER - Unable to ...
+
+Levels are TRACE DEBUG INFO WARN ERROR FATAL, subsystems are BMP SHADER GL WINDOW. Calls below
+LOGGING_MIN_LEVEL (INFO unless defined first) are compiled out, arguments and all. The rest
+can be switched at runtime with loggingFilter(), which costs one branch per call.
+
+Every logWarn / logError call site has its own token bucket, LOGGING_SITE_BURST lines at once and
+LOGGING_SITE_RATE a second after that. Lines over the limit are counted, and the count is written
+as "<format>  (repeated N times)" when the site gets through again, or at exit. Use logLimited()
+to give a site its own limit :
+          logLimited(ERROR, SHADER, 1, 0.2, "Uniform %s not found", name);   // 1 line, then 1 every 5s
+
+The log file stays open and lines are collected in memory, then written in one go once
+LOGGING_FLUSH_SIZE bytes are waiting, on ERROR and FATAL lines, when the day changes,
+or at exit. Call loggingFlush() to force it.
+
+loggingStartAsync(LOGGING_DROP) moves all of the file work to a background thread, the caller
+only formats the message into a queue slot. loggingStopAsync() drains it, it also runs at exit.
+
+loggingStartBinary(LOGGING_DROP) is the same, but nothing is formatted at all. The format string,
+the time and the raw arguments go to log-<date>.bin, and loggingDecode() (see tools/logdecode.c)
+turns that back into the usual text later. Format strings must be string literals.
 */
 
 #ifndef LOGGING_H
 #define LOGGING_H
 
-#include <stdio.h>   // FILE  fopen()   fclose()  wprintf()  fprintf()
-#include <string.h>  // strcpy()   strcat()
-#include <stdlib.h>  // malloc()   free()
+#include <stdio.h>   // FILE  fopen()   fclose()  fwrite()  vsnprintf()
+#include <string.h>  // strncmp()   memcpy()
+#include <stdlib.h>  // atexit()
 #include <stdarg.h>  // va_start    va_end   va_list
 #include <time.h>    // time()   localtime()   tzset()   strftime()
 #include <errno.h>   // errno
+#include <stdint.h>  // uintptr_t   intmax_t
+#include <stddef.h>  // ptrdiff_t
+
+#ifndef LOGGING_BUFFER_SIZE
+#define LOGGING_BUFFER_SIZE (64 * 1024)
+#endif
+
+#ifndef LOGGING_FLUSH_SIZE
+#define LOGGING_FLUSH_SIZE (LOGGING_BUFFER_SIZE / 2)
+#endif
+
+#ifndef LOGGING_ASYNC_SLOTS
+#define LOGGING_ASYNC_SLOTS 4096  // Must be a power of 2.
+#endif
+
+#ifndef LOGGING_ASYNC_LINE
+#define LOGGING_ASYNC_LINE 512
+#endif
+
+// How many times the writer yields on an empty queue before it parks and callers have to wake it.
+#ifndef LOGGING_WRITER_SPIN
+#define LOGGING_WRITER_SPIN 64
+#endif
+
+// How many format strings binary mode remembers without writing them out again.
+#ifndef LOGGING_BINARY_FORMATS
+#define LOGGING_BINARY_FORMATS 1024  // Must be a power of 2.
+#endif
+
+// What loggingStartAsync does when the queue is full.
+#define LOGGING_DROP  0   // Throw the message away and count it.
+#define LOGGING_BLOCK 1   // Wait for the writer to make room.
+
+#define LOG_LEVEL_TRACE 0
+#define LOG_LEVEL_DEBUG 1
+#define LOG_LEVEL_INFO  2
+#define LOG_LEVEL_WARN  3
+#define LOG_LEVEL_ERROR 4
+#define LOG_LEVEL_FATAL 5
+
+#ifndef LOGGING_MIN_LEVEL
+#define LOGGING_MIN_LEVEL LOG_LEVEL_INFO
+#endif
+
+// Subsystems, each level gets 8 bits of loggingMask, one per subsystem.
+#define LOG_BMP    0
+#define LOG_SHADER 1
+#define LOG_GL     2
+#define LOG_WINDOW 3
+#define LOG_ALL    (-1)
+
+#define LOG_BIT(level, subsystem) (1ull << ((level) * 8 + (subsystem)))
+
+#define LOG_NAME_TRACE "TRACE"
+#define LOG_NAME_DEBUG "DEBUG"
+#define LOG_NAME_INFO  "INFO"
+#define LOG_NAME_WARN  "WARNING"
+#define LOG_NAME_ERROR "ERROR"
+#define LOG_NAME_FATAL "FATAL"
+
+// The default per call site limit for logWarn and logError. A burst of 0 turns it off.
+#ifndef LOGGING_SITE_BURST
+#define LOGGING_SITE_BURST 5
+#endif
+
+#ifndef LOGGING_SITE_RATE
+#define LOGGING_SITE_RATE 1.0   // Lines a second once the burst is used up.
+#endif
+
+typedef struct LogSite
+{
+    const char* format;
+    double tokens;
+    long long lastMs;
+    int suppressed;
+    int started;
+    int listed;
+    volatile long lock;
+    struct LogSite* next;
+} LogSite;
+
+extern unsigned long long loggingMask;
+int loggingSiteAllow(LogSite* site, const char* format, double burst, double perSecond);
+
+#define LOGGING_FIRST(first, ...) first
+
+#define LOGGING_AT(level, name, subsystem, ...) \
+    do { if(loggingMask & LOG_BIT(level, LOG_##subsystem)) _logging(name " : " #subsystem " - " __VA_ARGS__); } while(0)
+
+#define LOGGING_LIMITED(level, name, subsystem, burst, perSecond, ...) \
+    do { \
+        static LogSite loggingSite; \
+        if((loggingMask & LOG_BIT(level, LOG_##subsystem)) && \
+           loggingSiteAllow(&loggingSite, name " : " #subsystem " - " LOGGING_FIRST(__VA_ARGS__, 0), burst, perSecond)) \
+            _logging(name " : " #subsystem " - " __VA_ARGS__); \
+    } while(0)
+
+#define logLimited(level, subsystem, burst, perSecond, ...) \
+    do { if(LOG_LEVEL_##level >= LOGGING_MIN_LEVEL) \
+        LOGGING_LIMITED(LOG_LEVEL_##level, LOG_NAME_##level, subsystem, burst, perSecond, __VA_ARGS__); } while(0)
+
+#if LOGGING_SITE_BURST > 0
+#define LOGGING_SITE(level, name, subsystem, ...) LOGGING_LIMITED(level, name, subsystem, LOGGING_SITE_BURST, LOGGING_SITE_RATE, __VA_ARGS__)
+#else
+#define LOGGING_SITE(level, name, subsystem, ...) LOGGING_AT(level, name, subsystem, __VA_ARGS__)
+#endif
+
+#if LOGGING_MIN_LEVEL <= LOG_LEVEL_TRACE
+#define logTrace(subsystem, ...) LOGGING_AT(LOG_LEVEL_TRACE, "TRACE", subsystem, __VA_ARGS__)
+#else
+#define logTrace(subsystem, ...) ((void)0)
+#endif
+#if LOGGING_MIN_LEVEL <= LOG_LEVEL_DEBUG
+#define logDebug(subsystem, ...) LOGGING_AT(LOG_LEVEL_DEBUG, "DEBUG", subsystem, __VA_ARGS__)
+#else
+#define logDebug(subsystem, ...) ((void)0)
+#endif
+#if LOGGING_MIN_LEVEL <= LOG_LEVEL_INFO
+#define logInfo(subsystem, ...)  LOGGING_AT(LOG_LEVEL_INFO, "INFO", subsystem, __VA_ARGS__)
+#else
+#define logInfo(subsystem, ...)  ((void)0)
+#endif
+#if LOGGING_MIN_LEVEL <= LOG_LEVEL_WARN
+#define logWarn(subsystem, ...)  LOGGING_SITE(LOG_LEVEL_WARN, "WARNING", subsystem, __VA_ARGS__)
+#else
+#define logWarn(subsystem, ...)  ((void)0)
+#endif
+#if LOGGING_MIN_LEVEL <= LOG_LEVEL_ERROR
+#define logError(subsystem, ...) LOGGING_SITE(LOG_LEVEL_ERROR, "ERROR", subsystem, __VA_ARGS__)
+#else
+#define logError(subsystem, ...) ((void)0)
+#endif
+#define logFatal(subsystem, ...) LOGGING_AT(LOG_LEVEL_FATAL, "FATAL", subsystem, __VA_ARGS__)
 
 #define logging(...) _logging(__VA_ARGS__)
 
 void _logging(const char* fmt, ...);
+void loggingFlush(void);
+int  loggingStartAsync(int overflowPolicy);
+void loggingStopAsync(void);
+long long loggingDropped(void);
+int  loggingStartBinary(int overflowPolicy);
+int  loggingDecode(FILE* in, FILE* out);
+
+/*! @breif
+    This sets the lowest level written for a subsystem at runtime. Levels compiled out stay out.
+	@param[in] LOG_BMP, LOG_SHADER, LOG_GL, LOG_WINDOW or LOG_ALL.
+	@param[in] The lowest level to write, LOG_LEVEL_FATAL + 1 turns the subsystem off.
+*/
+void loggingFilter(int subsystem, int minLevel);
 
 #endif // LOGGING_H
 
-#ifdef LOGGING_IMPLEMENTATION
+#if defined(LOGGING_IMPLEMENTATION) && !defined(LOGGING_IMPLEMENTATION_DONE)
+#define LOGGING_IMPLEMENTATION_DONE
 
-void _logging(const char* fmt, ...)
+#include "thread.h"
+
+#define LOGGING_BINARY_MAGIC "BINLOG1\n"  // Starts every binary log, and again each time it is reopened.
+
+unsigned long long loggingMask = ~0ull;
+
+// ERROR and FATAL lines go to the file right away.
+#define LOGGING_URGENT(text) (strncmp((text), "ERROR", 5) == 0 || strncmp((text), "FATAL", 5) == 0)
+
+// A Mutex rather than a SpinLock, whoever holds it may be writing to the disk. It is made on first use.
+static Mutex logLock;
+static Atomic64 logLockReady = 0;
+static SpinLock logLockSetup = 0;
+static FILE* logFile = NULL;
+static int logDay = -1;          // Year * 1000 + day of the year the open file belongs to.
+static time_t logSecond = 0;     // The second logStamp was made for.
+static char logStamp[51];
+static size_t logStampLength = 0;
+static char logBuffer[LOGGING_BUFFER_SIZE];
+static size_t logUsed = 0;
+static int logExitHooked = 0;
+static int logBinary = 0;
+static unsigned int logGeneration = 0;  // Counts the files opened, binary definitions are per file.
+static LogSite* logSites = NULL;        // Sites that have dropped lines at some point.
+static SpinLock logSitesLock = 0;
+
+static void loggingReportRepeats(void);
+
+static void loggingLock(void)
 {
-    char datestr[51];
-    time_t t = time(NULL);
-    tzset();
-    char* fileName = malloc(sizeof(char) * 19);
-    strftime(datestr, sizeof(datestr) - 1,  "%m-%d-%Y", localtime(&t));
-    strcpy(fileName, "log-");
-    strcat(fileName, datestr);
-    strcat(fileName, ".txt");
-    FILE *file = fopen(fileName, "a+");
-    if(file == NULL)
-    {
-        free(fileName);
-        wprintf(L"ERROR : Unable to create log file !!\n");
+    if(!AtomicLoad64(&logLockReady))
+    {
+        SpinLockAcquire(&logLockSetup);
+        if(!AtomicLoad64(&logLockReady))
+        {
+            MutexInit(&logLock);
+            AtomicStore64(&logLockReady, 1);
+        }
+        SpinLockRelease(&logLockSetup);
+    }
+    MutexLock(&logLock);
+}
+
+static void loggingWriteBuffer(void)
+{
+    if(logFile != NULL && logUsed > 0)
+    {
+        fwrite(logBuffer, 1, logUsed, logFile);
+        fflush(logFile);
+    }
+    logUsed = 0;
+}
+
+static void loggingAtExit(void)
+{
+    loggingReportRepeats();
+    loggingLock();
+    loggingWriteBuffer();
+    if(logFile){fclose(logFile);}
+    logFile = NULL;
+    logDay = -1;
+    MutexUnlock(&logLock);
+}
+
+static void loggingUpdateTime(time_t t)
+{
+    // Formatting the time and checking the day only happen once a second.
+    if(t == logSecond && logFile != NULL){return;}
+    logSecond = t;
+
+    struct tm* now = localtime(&t);
+    int day = (now->tm_year + 1900) * 1000 + now->tm_yday;
+    if(day != logDay)
+    {
+        char datestr[51];
+        char fileName[64];
+        loggingWriteBuffer();
+        if(logFile){fclose(logFile);}
+
+        strftime(datestr, sizeof(datestr) - 1,  "%m-%d-%Y", now);
+        snprintf(fileName, sizeof(fileName), logBinary ? "log-%s.bin" : "log-%s.txt", datestr);
+        logFile = fopen(fileName, logBinary ? "ab" : "a+");
+        if(logFile == NULL)
+        {
+            fprintf(stderr, "ERROR : Unable to create log file !!\n");
+        } else {
+            if(errno == 22)
+            {
+                errno = 0;
+            }
+            logDay = day;
+            logGeneration++;
+            if(logBinary)
+            {
+                fwrite(LOGGING_BINARY_MAGIC, 1, sizeof(LOGGING_BINARY_MAGIC) - 1, logFile);
+            }
+        }
+        if(!logExitHooked)
+        {
+            atexit(loggingAtExit);
+            logExitHooked = 1;
+        }
+    }
+    strftime(logStamp, sizeof(logStamp) - 1,  "%b/%d/%Y  %H:%M", now);
+    logStampLength = strlen(logStamp);
+}
+
+// Binary mode. A message is stored as the address of its format string, the time and the raw
+// arguments, nothing gets formatted. The file gets one record per message, plus a definition
+// record the first time each format string shows up in it :
+//     'F'  id (4)  length (2)  format text
+//     'M'  id (4)  time (8)  length (2)  arguments
+// Integers are stored as 8 bytes, floating point as a double, strings as length (2) and bytes.
+// Everything is native byte order, decode on the same kind of machine.
+
+typedef struct LogSpec
+{
+    const char* start;       // The '%'.
+    const char* modifiers;   // Where the length modifiers start, flags / width / precision come before.
+    const char* end;         // Just past the conversion character.
+    int stars;               // '*' width or precision, each takes an int argument.
+    int size;                // One of the LOG_SIZE_ values.
+    char conversion;
+} LogSpec;
+
+enum { LOG_SIZE_INT, LOG_SIZE_LONG, LOG_SIZE_LLONG, LOG_SIZE_SIZE, LOG_SIZE_MAX, LOG_SIZE_PTRDIFF, LOG_SIZE_LDOUBLE };
+
+typedef struct LogFormatId
+{
+    const char* format;
+    unsigned int id;
+    unsigned int generation;  // Which file the definition was written to.
+} LogFormatId;
+
+static unsigned int logNextId = 0;
+static unsigned int logFormatCount = 0;
+static LogFormatId logFormats[LOGGING_BINARY_FORMATS];
+
+// Finds the next conversion in a printf format. Returns NULL when there are no more.
+static const char* loggingNextSpec(const char* fmt, LogSpec* spec)
+{
+    const char* p = strchr(fmt, '%');
+    if(p == NULL){return NULL;}
+    spec->start = p++;
+    spec->stars = 0;
+    spec->size = LOG_SIZE_INT;
+
+    while(*p != '\0' && strchr("-+ #0'", *p) != NULL){p++;}
+    while(*p == '*' || (*p >= '0' && *p <= '9')){if(*p++ == '*'){spec->stars++;}}
+    if(*p == '.')
+    {
+        p++;
+        while(*p == '*' || (*p >= '0' && *p <= '9')){if(*p++ == '*'){spec->stars++;}}
+    }
+
+    spec->modifiers = p;
+    switch(*p)
+    {
+        case 'h': p++; if(*p == 'h'){p++;} break;
+        case 'l': p++; spec->size = LOG_SIZE_LONG; if(*p == 'l'){p++; spec->size = LOG_SIZE_LLONG;} break;
+        case 'L': p++; spec->size = LOG_SIZE_LDOUBLE; break;
+        case 'z': p++; spec->size = LOG_SIZE_SIZE; break;
+        case 'j': p++; spec->size = LOG_SIZE_MAX; break;
+        case 't': p++; spec->size = LOG_SIZE_PTRDIFF; break;
+    }
+    spec->conversion = *p;
+    if(*p != '\0'){p++;}
+    spec->end = p;
+    return p;
+}
+
+static int loggingPut(char* out, size_t room, size_t* used, const void* data, size_t size)
+{
+    if(*used + size > room){return 0;}
+    memcpy(out + *used, data, size);
+    *used += size;
+    return 1;
+}
+
+// Copies the arguments fmt uses into out, without formatting anything. Returns the bytes used.
+// Strings are cut short to fit, anything past the end of out is left off.
+static size_t loggingEncode(char* out, size_t room, const char* fmt, va_list ap)
+{
+    va_list args;
+    va_copy(args, ap);
+    size_t used = 0;
+    LogSpec spec;
+    while((fmt = loggingNextSpec(fmt, &spec)) != NULL)
+    {
+        long long integer = 0;
+        double real = 0.0;
+        int ok = 1;
+        for(int i = 0; i < spec.stars && ok; i++)
+        {
+            integer = va_arg(args, int);
+            ok = loggingPut(out, room, &used, &integer, 8);
+        }
+        if(!ok){break;}
+
+        switch(spec.conversion)
+        {
+            case 'd': case 'i':
+                switch(spec.size)
+                {
+                    case LOG_SIZE_LONG:    integer = va_arg(args, long); break;
+                    case LOG_SIZE_LLONG:   integer = va_arg(args, long long); break;
+                    case LOG_SIZE_SIZE:    integer = (long long)va_arg(args, size_t); break;
+                    case LOG_SIZE_MAX:     integer = (long long)va_arg(args, intmax_t); break;
+                    case LOG_SIZE_PTRDIFF: integer = (long long)va_arg(args, ptrdiff_t); break;
+                    default:               integer = va_arg(args, int); break;
+                }
+                ok = loggingPut(out, room, &used, &integer, 8);
+                break;
+            case 'u': case 'o': case 'x': case 'X':
+                switch(spec.size)
+                {
+                    case LOG_SIZE_LONG:    integer = (long long)va_arg(args, unsigned long); break;
+                    case LOG_SIZE_LLONG:   integer = (long long)va_arg(args, unsigned long long); break;
+                    case LOG_SIZE_SIZE:    integer = (long long)va_arg(args, size_t); break;
+                    case LOG_SIZE_MAX:     integer = (long long)va_arg(args, uintmax_t); break;
+                    case LOG_SIZE_PTRDIFF: integer = (long long)va_arg(args, ptrdiff_t); break;
+                    default:               integer = (long long)va_arg(args, unsigned int); break;
+                }
+                ok = loggingPut(out, room, &used, &integer, 8);
+                break;
+            case 'c':
+                integer = va_arg(args, int);
+                ok = loggingPut(out, room, &used, &integer, 8);
+                break;
+            case 'p':
+                integer = (long long)(uintptr_t)va_arg(args, void*);
+                ok = loggingPut(out, room, &used, &integer, 8);
+                break;
+            case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+                real = (spec.size == LOG_SIZE_LDOUBLE) ? (double)va_arg(args, long double) : va_arg(args, double);
+                ok = loggingPut(out, room, &used, &real, 8);
+                break;
+            case 's':
+            {
+                const char* text = va_arg(args, const char*);
+                if(text == NULL){text = "(null)";}
+                size_t length = strlen(text);
+                if(used + 2 > room){ok = 0; break;}
+                if(length > room - used - 2){length = room - used - 2;}
+                if(length > 0xFFFF){length = 0xFFFF;}
+                unsigned short stored = (unsigned short)length;
+                loggingPut(out, room, &used, &stored, 2);
+                loggingPut(out, room, &used, text, length);
+                break;
+            }
+            case '%':
+                break;
+            default:
+                ok = 0;  // %n or something unknown, the rest can't be read safely.
+                break;
+        }
+        if(!ok){break;}
+    }
+    va_end(args);
+    return used;
+}
+
+static void loggingAppendRaw(const void* data, size_t size)
+{
+    if(logUsed + size > LOGGING_BUFFER_SIZE){loggingWriteBuffer();}
+    if(size > LOGGING_BUFFER_SIZE)
+    {
+        fwrite(data, 1, size, logFile);
+        return;
+    }
+    memcpy(logBuffer + logUsed, data, size);
+    logUsed += size;
+}
+
+static unsigned int loggingFormatId(const char* fmt)
+{
+    // Format strings are string literals, so the address is enough to tell them apart.
+    size_t mask = LOGGING_BINARY_FORMATS - 1;
+    size_t index = (size_t)(((uintptr_t)fmt >> 3) * 2654435761u) & mask;
+    LogFormatId* entry = NULL;
+    while(logFormats[index].format != NULL)
+    {
+        if(logFormats[index].format == fmt)
+        {
+            entry = &logFormats[index];
+            if(entry->generation == logGeneration){return entry->id;}
+            break;
+        }
+        index = (index + 1) & mask;
+    }
+
+    unsigned int id;
+    if(entry != NULL)
+    {
+        id = entry->id;
+        entry->generation = logGeneration;
+    } else {
+        id = ++logNextId;
+        if(logFormatCount < LOGGING_BINARY_FORMATS * 3 / 4)
+        {
+            logFormats[index].format = fmt;
+            logFormats[index].id = id;
+            logFormats[index].generation = logGeneration;
+            logFormatCount++;
+        }
+    }
+
+    size_t length = strlen(fmt);
+    if(length > 0xFFFF){length = 0xFFFF;}
+    unsigned short stored = (unsigned short)length;
+    loggingAppendRaw("F", 1);
+    loggingAppendRaw(&id, 4);
+    loggingAppendRaw(&stored, 2);
+    loggingAppendRaw(fmt, length);
+    return id;
+}
+
+static void loggingAppendBinary(const char* fmt, time_t t, const char* args, size_t length)
+{
+    unsigned int id = loggingFormatId(fmt);
+    long long stamp = (long long)t;
+    unsigned short stored = (unsigned short)length;
+    loggingAppendRaw("M", 1);
+    loggingAppendRaw(&id, 4);
+    loggingAppendRaw(&stamp, 8);
+    loggingAppendRaw(&stored, 2);
+    loggingAppendRaw(args, length);
+}
+
+// Async mode. Callers claim a slot in a bounded lock-free ring (many producers, one consumer),
+// format the message straight into it and publish it. The writer thread adds the timestamps
+// and does all of the file I/O. Lines longer than a slot skip the ring and are written directly.
+typedef struct LogSlot
+{
+    Atomic64 sequence;
+    const char* format;   // Binary mode, text holds the arguments.
+    time_t time;
+    int length;
+    char text[LOGGING_ASYNC_LINE];
+} LogSlot;
+
+static LogSlot* logSlots = NULL;     // Never freed, a late caller may still be writing into it.
+static Atomic64 logEnqueue = 0;
+static long long logDequeue = 0;     // Writer thread only.
+static Atomic64 logAsync = 0;
+static Atomic64 logAsyncQuit = 0;
+static Atomic64 logDropped = 0;
+static long long logDroppedReported = 0;
+static Atomic64 logWriterIdle = 0;   // 1 while the writer is parked, the caller that clears it posts logWake.
+static Semaphore logWake;
+static int logPolicy = LOGGING_DROP;
+static Thread logWriter;
+
+static void loggingAppend(const char* text, size_t length)
+{
+    size_t need = logStampLength + 3 + length + 1;
+    if(logUsed + need > LOGGING_BUFFER_SIZE){loggingWriteBuffer();}
+    if(need > LOGGING_BUFFER_SIZE)
+    {
+        fprintf(logFile, "%s - %.*s\n", logStamp, (int)length, text);
+        return;
+    }
+    char* line = logBuffer + logUsed;
+    memcpy(line, logStamp, logStampLength);
+    memcpy(line + logStampLength, " - ", 3);
+    memcpy(line + logStampLength + 3, text, length);
+    line[need - 1] = '\n';
+    logUsed += need;
+}
+
+static void loggingAppendDropped(long long count, ...)
+{
+    const char* fmt = "WARNING : Logging dropped %lld messages, the queue was full";
+    char note[96];
+    va_list ap;
+    va_start(ap, count);
+    if(logBinary)
+    {
+        size_t length = loggingEncode(note, sizeof(note), fmt, ap);
+        loggingAppendBinary(fmt, time(NULL), note, length);
+    } else {
+        int length = vsnprintf(note, sizeof(note), fmt, ap);
+        loggingAppend(note, (size_t)length);
+    }
+    va_end(ap);
+}
+
+static int loggingWriterHasWork(void)
+{
+    const long long mask = LOGGING_ASYNC_SLOTS - 1;
+    return AtomicLoad64(&logSlots[logDequeue & mask].sequence) == logDequeue + 1 || AtomicLoad64(&logAsyncQuit);
+}
+
+static int loggingWriterThread(void* arg)
+{
+    (void)arg;
+    const long long mask = LOGGING_ASYNC_SLOTS - 1;
+    for(;;)
+    {
+        int count = 0;
+        int flush = 0;
+        loggingLock();
+        while(count < 256)
+        {
+            LogSlot* slot = &logSlots[logDequeue & mask];
+            if(AtomicLoad64(&slot->sequence) != logDequeue + 1){break;}
+
+            if(slot->format != NULL)
+            {
+                loggingUpdateTime(slot->time);
+                if(logFile){loggingAppendBinary(slot->format, slot->time, slot->text, (size_t)slot->length);}
+                if(LOGGING_URGENT(slot->format)){flush = 1;}
+            } else if(slot->length >= 0) {  // -1 means the caller wrote it directly.
+                loggingUpdateTime(slot->time);
+                if(logFile){loggingAppend(slot->text, (size_t)slot->length);}
+                if(LOGGING_URGENT(slot->text)){flush = 1;}
+            }
+            AtomicStore64(&slot->sequence, logDequeue + LOGGING_ASYNC_SLOTS);
+            logDequeue++;
+            count++;
+        }
+
+        long long dropped = AtomicLoad64(&logDropped);
+        if(dropped != logDroppedReported && logFile)
+        {
+            loggingUpdateTime(time(NULL));
+            loggingAppendDropped(dropped - logDroppedReported);
+            logDroppedReported = dropped;
+        }
+
+        // Write out when there's a lot waiting, on errors, or as soon as the queue goes quiet.
+        if(flush || count == 0 || logUsed >= LOGGING_FLUSH_SIZE)
+        {
+            loggingWriteBuffer();
+        }
+        MutexUnlock(&logLock);
+
+        if(count == 0)
+        {
+            if(AtomicLoad64(&logAsyncQuit) && AtomicLoad64(&logEnqueue) == logDequeue){break;}
+
+            // Lines come in bursts, so wait a little before parking and making callers wake us.
+            for(int spin = 0; spin < LOGGING_WRITER_SPIN && !loggingWriterHasWork(); spin++)
+            {
+                ThreadYield();
+            }
+            if(loggingWriterHasWork()){continue;}
+
+            // Say we are parked before looking at the queue again, a caller that published in
+            // between sees the flag. Both sides use a full barrier, so one of them wins.
+            AtomicAdd64(&logWriterIdle, 1);
+            long long idle = 1;
+            if(!loggingWriterHasWork() || !AtomicCAS64(&logWriterIdle, &idle, 0))
+            {
+                // Either nothing came, or a caller already took the flag and posts.
+                SemWait(&logWake);
+            }
+        }
+    }
+    return 0;
+}
+
+// No lock. Only the caller that clears the flag posts, the rest only pay for the barrier.
+static void loggingWakeWriter(void)
+{
+    long long idle = 1;
+    if(AtomicAdd64(&logWriterIdle, 0) == 0){return;}
+    if(AtomicCAS64(&logWriterIdle, &idle, 0)){SemPost(&logWake);}
+}
+
+static int loggingPush(const char* fmt, va_list ap)
+{
+    const long long mask = LOGGING_ASYNC_SLOTS - 1;
+    long long position = AtomicLoad64(&logEnqueue);
+    LogSlot* slot;
+    for(;;)
+    {
+        slot = &logSlots[position & mask];
+        long long difference = AtomicLoad64(&slot->sequence) - position;
+        if(difference == 0)
+        {
+            if(AtomicCAS64(&logEnqueue, &position, position + 1)){break;}
+        } else if(difference < 0) {
+            // Full.
+            if(logPolicy == LOGGING_DROP)
+            {
+                AtomicAdd64(&logDropped, 1);
+                return 1;
+            }
+            ThreadYield();
+            position = AtomicLoad64(&logEnqueue);
+        } else {
+            position = AtomicLoad64(&logEnqueue);
+        }
+    }
+
+    // The slot is ours until the sequence is published.
+    slot->time = time(NULL);
+    if(logBinary)
+    {
+        slot->format = fmt;
+        slot->length = (int)loggingEncode(slot->text, LOGGING_ASYNC_LINE, fmt, ap);
+        AtomicStore64(&slot->sequence, position + 1);
+        loggingWakeWriter();
+        return 1;
+    }
+    slot->format = NULL;
+    va_list copy;
+    va_copy(copy, ap);
+    int length = vsnprintf(slot->text, LOGGING_ASYNC_LINE, fmt, copy);
+    va_end(copy);
+    int fits = (length >= 0 && length < LOGGING_ASYNC_LINE);
+    slot->length = fits ? length : -1;
+    AtomicStore64(&slot->sequence, position + 1);
+    loggingWakeWriter();
+    return fits;
+}
+
+static int loggingStart(int overflowPolicy, int binary)
+{
+    if(AtomicLoad64(&logAsync))
+    {
+        if(logBinary == binary){return 1;}
+        loggingStopAsync();
+    }
+    if(logSlots == NULL)
+    {
+        logSlots = (LogSlot*)malloc(sizeof(LogSlot) * LOGGING_ASYNC_SLOTS);
+        if(logSlots == NULL){return 0;}
+        for(long long i = 0; i < LOGGING_ASYNC_SLOTS; i++)
+        {
+            logSlots[i].sequence = logEnqueue + i;
+        }
+        logDequeue = logEnqueue;
+    }
+    logPolicy = overflowPolicy;
+
+    // Open the file now so its atexit hook is in before ours, hooks run in reverse.
+    loggingLock();
+    if(binary)
+    {
+        loggingWriteBuffer();
+        if(logFile){fclose(logFile);}
+        logFile = NULL;
+        logDay = -1;
+        logBinary = 1;
+    }
+    loggingUpdateTime(time(NULL));
+    MutexUnlock(&logLock);
+
+    static int wakeReady = 0;
+    if(!wakeReady)
+    {
+        SemInit(&logWake);
+        wakeReady = 1;
+    }
+    AtomicStore64(&logAsyncQuit, 0);
+    if(!ThreadStart(&logWriter, loggingWriterThread, NULL)){return 0;}
+    AtomicStore64(&logAsync, 1);
 
+    static int hooked = 0;
+    if(!hooked)
+    {
+        atexit(loggingStopAsync);
+        hooked = 1;
+    }
+    return 1;
+}
+
+int loggingStartAsync(int overflowPolicy)
+{
+    return loggingStart(overflowPolicy, 0);
+}
+
+int loggingStartBinary(int overflowPolicy)
+{
+    return loggingStart(overflowPolicy, 1);
+}
+
+void loggingStopAsync(void)
+{
+    if(!AtomicLoad64(&logAsync)){return;}
+    AtomicStore64(&logAsync, 0);
+    AtomicStore64(&logAsyncQuit, 1);
+    loggingWakeWriter();
+    ThreadJoin(&logWriter); // Drains the queue first.
+
+    if(logBinary)
+    {
+        // Back to text, the next line reopens the .txt file.
+        loggingLock();
+        loggingWriteBuffer();
+        if(logFile){fclose(logFile);}
+        logFile = NULL;
+        logDay = -1;
+        logBinary = 0;
+        MutexUnlock(&logLock);
+    }
+}
+
+long long loggingDropped(void)
+{
+    return AtomicLoad64(&logDropped);
+}
+
+static long long loggingNowMs(void)
+{
+#ifdef _WIN32
+    return (long long)GetTickCount64();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+#endif
+}
+
+int loggingSiteAllow(LogSite* site, const char* format, double burst, double perSecond)
+{
+    long long now = loggingNowMs();
+    int repeated = 0;
+    int allow;
+
+    SpinLockAcquire(&site->lock);
+    if(!site->started)
+    {
+        site->format = format;
+        site->tokens = burst;
+        site->started = 1;
     } else {
-        if(errno == 22)
+        site->tokens += (double)(now - site->lastMs) * perSecond / 1000.0;
+        if(site->tokens > burst){site->tokens = burst;}
+    }
+    site->lastMs = now;
+
+    allow = (site->tokens >= 1.0);
+    if(allow)
+    {
+        site->tokens -= 1.0;
+        repeated = site->suppressed;
+        site->suppressed = 0;
+    } else {
+        site->suppressed++;
+        if(!site->listed)
         {
-            errno = 0;
+            SpinLockAcquire(&logSitesLock);
+            site->next = logSites;
+            logSites = site;
+            SpinLockRelease(&logSitesLock);
+            site->listed = 1;
         }
-        free(fileName);
+    }
+    SpinLockRelease(&site->lock);
+
+    if(repeated > 0){_logging("%s  (repeated %d times)", format, repeated);}
+    return allow;
+}
+
+static void loggingReportRepeats(void)
+{
+    SpinLockAcquire(&logSitesLock);
+    LogSite* site = logSites;
+    SpinLockRelease(&logSitesLock);
+    for(; site != NULL; site = site->next)
+    {
+        SpinLockAcquire(&site->lock);
+        int repeated = site->suppressed;
+        site->suppressed = 0;
+        SpinLockRelease(&site->lock);
+        if(repeated > 0){_logging("%s  (repeated %d times)", site->format, repeated);}
+    }
+}
+
+void loggingFilter(int subsystem, int minLevel)
+{
+    for(int level = LOG_LEVEL_TRACE; level <= LOG_LEVEL_FATAL; level++)
+    {
+        for(int bit = 0; bit < 8; bit++)
+        {
+            if(subsystem != LOG_ALL && subsystem != bit){continue;}
+            if(level >= minLevel)
+            {
+                loggingMask |= LOG_BIT(level, bit);
+            } else {
+                loggingMask &= ~LOG_BIT(level, bit);
+            }
+        }
+    }
+}
+
+void loggingFlush(void)
+{
+    loggingLock();
+    loggingWriteBuffer();
+    MutexUnlock(&logLock);
+}
+
+void _logging(const char* fmt, ...)
+{
+    static int zoneSet = 0;
+
+    if(AtomicLoad64(&logAsync))
+    {
         va_list ap;
-        strftime(datestr, sizeof(datestr) - 1,  "%b/%d/%Y  %H:%M", localtime(&t));
-        fprintf(file, "%s - ", datestr);
         va_start(ap, fmt);
-        vfprintf(file, fmt, ap);
+        int queued = loggingPush(fmt, ap);
         va_end(ap);
-        fprintf(file, "\n");
-        fclose(file);
+        if(queued){return;}
+    }
+
+    time_t t = time(NULL);
+
+    loggingLock();
+    if(!zoneSet)
+    {
+        tzset();
+        zoneSet = 1;
+    }
+    loggingUpdateTime(t);
+    if(logFile == NULL)
+    {
+        MutexUnlock(&logLock);
+        return;
+    }
+
+    if(logBinary)
+    {
+        // Only callers that raced with loggingStartBinary() or loggingStopAsync() end up here.
+        char args[LOGGING_ASYNC_LINE];
+        va_list ap;
+        va_start(ap, fmt);
+        size_t length = loggingEncode(args, sizeof(args), fmt, ap);
+        va_end(ap);
+        loggingAppendBinary(fmt, t, args, length);
+        if(LOGGING_URGENT(fmt)){loggingWriteBuffer();}
+        MutexUnlock(&logLock);
+        return;
+    }
+
+    for(int attempt = 0; attempt < 2; attempt++)
+    {
+        size_t room = LOGGING_BUFFER_SIZE - logUsed;
+        if(room > logStampLength + 4)
+        {
+            char* line = logBuffer + logUsed;
+            memcpy(line, logStamp, logStampLength);
+            memcpy(line + logStampLength, " - ", 3);
+            size_t header = logStampLength + 3;
+
+            va_list ap;
+            va_start(ap, fmt);
+            int length = vsnprintf(line + header, room - header, fmt, ap);
+            va_end(ap);
+
+            if(length >= 0 && header + (size_t)length + 1 < room)
+            {
+                line[header + length] = '\n';
+                logUsed += header + length + 1;
+                break;
+            }
+        }
+
+        if(attempt == 0)
+        {
+            loggingWriteBuffer(); // Make room and try again.
+        } else {
+            // Bigger than the whole buffer, write it straight out.
+            va_list ap;
+            fprintf(logFile, "%s - ", logStamp);
+            va_start(ap, fmt);
+            vfprintf(logFile, fmt, ap);
+            va_end(ap);
+            fprintf(logFile, "\n");
+        }
     }
+
+    if(logUsed >= LOGGING_FLUSH_SIZE || LOGGING_URGENT(fmt))
+    {
+        loggingWriteBuffer();
+    }
+    MutexUnlock(&logLock);
+}
+
+static int loggingRead(FILE* in, void* data, size_t size)
+{
+    return fread(data, 1, size, in) == size;
 }
 
+static void loggingDecodeMessage(FILE* out, const char* fmt, const unsigned char* args, size_t length)
+{
+    size_t used = 0;
+    LogSpec spec;
+    const char* text = fmt;
+    while(loggingNextSpec(text, &spec) != NULL)
+    {
+        fwrite(text, 1, (size_t)(spec.start - text), out);
+        text = spec.end;
 
-#endif // LOGGING_IMPLEMENTATION
+        // Rebuild the conversion with the stored '*' values written in, and the size the value was stored as.
+        char conversion[64];
+        size_t n = 0;
+        for(const char* p = spec.start; p < spec.modifiers && n < 40; p++)
+        {
+            if(*p == '*')
+            {
+                long long value = 0;
+                if(used + 8 <= length){memcpy(&value, args + used, 8);}
+                used += 8;
+                n += (size_t)snprintf(conversion + n, sizeof(conversion) - n, "%d", (int)value);
+            } else {
+                conversion[n++] = *p;
+            }
+        }
+        conversion[n] = '\0';
 
+        char c = spec.conversion;
+        if(c == '%'){fputc('%', out); continue;}
+        if(c == 's')
+        {
+            unsigned short size = 0;
+            if(used + 2 > length){break;}
+            memcpy(&size, args + used, 2);
+            used += 2;
+            if(used + size > length){size = (unsigned short)(length - used);}
+            char* string = (char*)malloc((size_t)size + 1);
+            if(string == NULL){break;}
+            memcpy(string, args + used, size);
+            string[size] = '\0';
+            used += size;
+            strcat(conversion, "s");
+            fprintf(out, conversion, string);
+            free(string);
+            continue;
+        }
+
+        if(used + 8 > length){break;}  // The rest was cut off when it was logged.
+        long long value;
+        double real;
+        memcpy(&value, args + used, 8);
+        memcpy(&real, args + used, 8);
+        used += 8;
+        switch(c)
+        {
+            case 'd': case 'i':
+                strcat(conversion, "lld");
+                conversion[strlen(conversion) - 1] = c;
+                fprintf(out, conversion, value);
+                break;
+            case 'u': case 'o': case 'x': case 'X':
+                strcat(conversion, "llu");
+                conversion[strlen(conversion) - 1] = c;
+                fprintf(out, conversion, (unsigned long long)value);
+                break;
+            case 'c':
+                strcat(conversion, "c");
+                fprintf(out, conversion, (int)value);
+                break;
+            case 'p':
+                strcat(conversion, "p");
+                fprintf(out, conversion, (void*)(uintptr_t)value);
+                break;
+            default:
+                n = strlen(conversion);
+                conversion[n] = c;
+                conversion[n + 1] = '\0';
+                fprintf(out, conversion, real);
+                break;
+        }
+    }
+    fputs(text, out);
+}
+
+int loggingDecode(FILE* in, FILE* out)
+{
+    char magic[sizeof(LOGGING_BINARY_MAGIC) - 1];
+    char** formats = NULL;
+    unsigned int formatCount = 0;
+    unsigned char* args = NULL;
+    int lines = 0;
+
+    // Day files are appended to, so the header and the definitions can show up again later on.
+    while(loggingRead(in, magic, 1))
+    {
+        if(magic[0] == LOGGING_BINARY_MAGIC[0])
+        {
+            if(!loggingRead(in, magic + 1, sizeof(magic) - 1) || memcmp(magic, LOGGING_BINARY_MAGIC, sizeof(magic)) != 0){lines = -1; break;}
+        } else if(magic[0] == 'F') {
+            unsigned int id;
+            unsigned short length;
+            if(!loggingRead(in, &id, 4) || !loggingRead(in, &length, 2)){lines = -1; break;}
+            if(id >= formatCount)
+            {
+                unsigned int count = id + 64;
+                char** grown = (char**)realloc(formats, sizeof(char*) * count);
+                if(grown == NULL){lines = -1; break;}
+                memset(grown + formatCount, 0, sizeof(char*) * (count - formatCount));
+                formats = grown;
+                formatCount = count;
+            }
+            free(formats[id]);
+            formats[id] = (char*)malloc((size_t)length + 1);
+            if(formats[id] == NULL || !loggingRead(in, formats[id], length)){lines = -1; break;}
+            formats[id][length] = '\0';
+        } else if(magic[0] == 'M') {
+            unsigned int id;
+            long long stamp;
+            unsigned short length;
+            if(!loggingRead(in, &id, 4) || !loggingRead(in, &stamp, 8) || !loggingRead(in, &length, 2)){lines = -1; break;}
+            unsigned char* grown = (unsigned char*)realloc(args, (size_t)length + 1);
+            if(grown == NULL){lines = -1; break;}
+            args = grown;
+            if(!loggingRead(in, args, length)){lines = -1; break;}
+
+            time_t t = (time_t)stamp;
+            char datestr[51];
+            strftime(datestr, sizeof(datestr) - 1, "%b/%d/%Y  %H:%M", localtime(&t));
+            fprintf(out, "%s - ", datestr);
+            if(id < formatCount && formats[id] != NULL)
+            {
+                loggingDecodeMessage(out, formats[id], args, length);
+            } else {
+                fprintf(out, "(unknown format %u)", id);
+            }
+            fputc('\n', out);
+            lines++;
+        } else {
+            lines = -1;
+            break;
+        }
+    }
+
+    for(unsigned int i = 0; i < formatCount; i++){free(formats[i]);}
+    free(formats);
+    free(args);
+    return lines;
+}
+
+#endif // LOGGING_IMPLEMENTATION
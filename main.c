@@ -2,12 +2,48 @@
 /*
  This is an OpenGL Boiler Plate - Created by ThatOSDev
  NOTE : For windows, add the GDI32 library.  -lgdi32
+ NOTE : For linux, add the pthread library.  -lpthread
+ NOTE : For headless mode, #define USE_HEADLESS and add libs/glad/src/egl.c
+        Run with  --headless [frames]  to render without a window and save headless.bmp
+ NOTE : Run with  --binary-log  to write log-<date>.bin, tools/logdecode.c turns it into text.
+ NOTE : Build with -DUSE_PROFILER to save a CPU trace as trace.json (chrome://tracing or Perfetto).
+ NOTE : Run with  --stream  to also draw a spinning triangle whose vertices are rewritten every frame (stream.h).
+ NOTE : Run with  --benchmark [frames] [--baseline file.json] [--tolerance 0.10]  (needs USE_HEADLESS)
+        to render a fixed scene, write benchmark.json and exit with 1 if it got slower than the baseline.
 */
 
 #define BMP_IMPLEMENTATION
 #include "bmp.h"
 #include "shader.h"  // This includes GLAD and LOGGING
+#define CAPTURE_IMPLEMENTATION
+#include "capture.h" // Press F12 to start / stop recording frames
 #include <GLFW/glfw3.h> // NOTE : Make sure to #define _GLFW_WIN32
+#ifdef USE_HEADLESS
+#define HEADLESS_IMPLEMENTATION
+#include "headless.h"
+#endif
+#define PROFILER_IMPLEMENTATION
+#include "profiler.h" // ProfileNow() is always built, the PROFILE_ macros only with USE_PROFILER.
+#define FRAMESTATS_IMPLEMENTATION
+#include "framestats.h"
+#define FENCERING_IMPLEMENTATION
+#define STREAM_IMPLEMENTATION
+#include "stream.h"
+#define GLSTATE_IMPLEMENTATION
+#include "glstate.h"  // Binds go through the state cache, redundant ones never reach the driver.
+#define TEXTURE_IMPLEMENTATION
+#include "texture.h"
+#define ASSETS_IMPLEMENTATION
+#include "assets.h"   // Textures and shaders load on background threads while frames keep coming.
+#include <string.h>  // strcmp()  memcpy()
+#include <math.h>    // sinf()  cosf()
+
+#define BENCHMARK_DRAWS 64  // The benchmark scene draws the triangle this many times a frame.
+
+FrameCapture capture;
+FrameStats frameStats;
+StreamBuffer vertexStream;  // Vertices written every frame with --stream, see stream.h
+AssetStreamer assets;
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void processInput(GLFWwindow *window);
@@ -30,43 +66,115 @@ const char *fragmentShaderSource = "#version 330 core\n"
     "   FragColor = vec4(ourColor, 1.0f);\n"
     "}\n\0";
 
-int main(void)
+int main(int argc, char** argv)
 {
-    GLFWwindow* window;
+    GLFWwindow* window = NULL;
+    int headlessFrames = 0;
+    int binaryLog = 0;
+    int benchmark = 0;
+    int streaming = 0;
+    const char* baseline = NULL;
+    double tolerance = 0.10;
 
-    if(!glfwInit())
+    for(int i = 1; i < argc; i++)
     {
-        logging("ERROR : Unable to initialize GLFW3");
-        return -1;
+        if(strcmp(argv[i], "--headless") == 0)
+        {
+            headlessFrames = (i + 1 < argc) ? atoi(argv[++i]) : 1;
+            if(headlessFrames < 1){headlessFrames = 1;}
+        } else if(strcmp(argv[i], "--binary-log") == 0) {
+            binaryLog = 1;
+        } else if(strcmp(argv[i], "--stream") == 0) {
+            streaming = 1;
+        } else if(strcmp(argv[i], "--benchmark") == 0) {
+            benchmark = 1;
+            headlessFrames = (i + 1 < argc && argv[i + 1][0] != '-') ? atoi(argv[++i]) : 1000;
+            if(headlessFrames < 1){headlessFrames = 1;}
+        } else if(strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+            baseline = argv[++i];
+        } else if(strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc) {
+            tolerance = atof(argv[++i]);
+        }
     }
 
-    unsigned char* data = GenerateBMP(512, 512, 32, 0, 255, 255, 255);
-    if(data)
+    PROFILE_THREAD("main");
+
+    // The render loop never waits on the log file. Anything still queued is written at exit.
+    if(binaryLog)
     {
-        SaveBMP("SaveTest.bmp", data, 512, 512, 32);
-        free(data);
+        loggingStartBinary(LOGGING_DROP);
     } else {
-        logging("ERROR : Unable to generate a BMP");
+        loggingStartAsync(LOGGING_DROP);
     }
 
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+#ifdef USE_HEADLESS
+    Headless headless;
+#else
+    if(headlessFrames)
+    {
+        logError(WINDOW, "Built without USE_HEADLESS, --headless is not available");
+        return -1;
+    }
+#endif
 
-    window = glfwCreateWindow(640, 480, "ThatOSDev's OpenGL Boiler Plate", NULL, NULL);
-    if(!window)
+    if(!headlessFrames && !glfwInit())
     {
-        logging("ERROR : Unable to create window");
-        glfwTerminate();
+        logError(WINDOW, "Unable to initialize GLFW3");
         return -1;
     }
 
-    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
-    glfwMakeContextCurrent(window);
+    if(headlessFrames)
+    {
+#ifdef USE_HEADLESS
+        if(!StartHeadless(&headless, 640, 480))
+        {
+            return -1;
+        }
+        // The streamer's threads and uploads would land in random timed frames of a benchmark.
+        if(!benchmark && !StartAssetStreamerHeadless(&assets, &headless))
+        {
+            logError(GL, "Asset streaming is unavailable, streamed assets will not load");
+        }
+#endif
+    } else {
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
-    gladLoadGL(glfwGetProcAddress);
+        window = glfwCreateWindow(640, 480, "ThatOSDev's OpenGL Boiler Plate", NULL, NULL);
+        if(!window)
+        {
+            logError(WINDOW, "Unable to create window");
+            glfwTerminate();
+            return -1;
+        }
 
-    unsigned int shaderProgram = LoadEmbeddedShaders(vertexShaderSource, fragmentShaderSource);
+        glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+        glfwMakeContextCurrent(window);
+
+        gladLoadGL(glfwGetProcAddress);
+        if(!StartAssetStreamer(&assets, window))
+        {
+            logError(GL, "Asset streaming is unavailable, streamed assets will not load");
+        }
+    }
+
+    // Shaders compile in the background while the rest of the loading happens.
+    ShaderBatch shaders;
+    InitShaderBatch(&shaders);
+    int triangleShader = AddShaderBatch(&shaders, vertexShaderSource, fragmentShaderSource);
+    SubmitShaderBatch(&shaders);
+
+    unsigned char* data = GenerateBMP(512, 512, 32, 0, 255, 255, 255);
+    if(data)
+    {
+        SaveBMP("SaveTest.bmp", data, 512, 512, 32);
+        free(data);
+    } else {
+        logError(BMP, "Unable to generate a BMP");
+    }
+    int testTexture = RequestTexture(&assets, "SaveTest.bmp");  // -1 when the streamer is not running.
+    int testTextureLogged = 0;
 
     float vertices[] = {
         // positions         // colors
@@ -78,9 +186,9 @@ int main(void)
     unsigned int VBO, VAO;
     glGenVertexArrays(1, &VAO);
     glGenBuffers(1, &VBO);
-    glBindVertexArray(VAO);
+    StateBindVertexArray(VAO);
 
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    StateBindBuffer(GL_ARRAY_BUFFER, VBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
 
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
@@ -88,38 +196,192 @@ int main(void)
     glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
     glEnableVertexAttribArray(1);
 
-    glUseProgram(shaderProgram);
+    // With --stream a second, spinning triangle is rewritten every frame through the ring.
+    unsigned int streamVAO = 0;
+    if(streaming && !CreateStreamBuffer(&vertexStream, 64 * 1024))
+    {
+        logError(GL, "Unable to create the stream buffer, drawing without --stream");
+        streaming = 0;
+    }
+    if(streaming)
+    {
+        glGenVertexArrays(1, &streamVAO);
+        StateBindVertexArray(streamVAO);
+        StateBindBuffer(GL_ARRAY_BUFFER, vertexStream.ring.buffer);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
+        glEnableVertexAttribArray(1);
+    }
+
+    FinishShaderBatch(&shaders);
+    unsigned int shaderProgram = GetShaderBatchProgram(&shaders, triangleShader);
+    FreeShaderBatch(&shaders);
+    if(triangleShader < 0)
+    {
+        logError(SHADER, "Unable to add the triangle shader to the batch, compiling it on its own");
+        shaderProgram = LoadEmbeddedShaders(vertexShaderSource, fragmentShaderSource);
+    }
 
     glClearColor(0.9f, 0.7f, 0.4f, 1.0f);
 
-    while (!glfwWindowShouldClose(window))
+    InitFrameStats(&frameStats);
+    int drawsPerFrame = benchmark ? BENCHMARK_DRAWS : 1;
+
+    int frame = 0;
+    while (headlessFrames ? frame < headlessFrames : !glfwWindowShouldClose(window))
     {
-        processInput(window);
+        BeginFrameStats(&frameStats);
+        PROFILE_BEGIN("frame");
+        if (window)
+        {
+            PROFILE_BEGIN("processInput");
+            processInput(window);
+            PROFILE_END("processInput");
+        }
 
+        PROFILE_BEGIN("draw");
+        PROFILE_GPU_BEGIN("glClear");
         glClear(GL_COLOR_BUFFER_BIT);
+        PROFILE_GPU_END("glClear");
+
+        UpdateAssetStreamer(&assets);
+        if(!testTextureLogged && AssetReady(&assets, testTexture) != 0)
+        {
+            const Texture* texture = GetAssetTexture(&assets, testTexture);
+            if(texture)
+            {
+                size_t textureBytes = 0;
+                GetTextureMemory(&textureBytes, NULL);
+                logInfo(GL, "Streamed SaveTest.bmp (%dx%d) by frame %d, %zu bytes of textures", texture->width, texture->height, frame, textureBytes);
+            }
+            testTextureLogged = 1;
+        }
+
+        StateUseProgram(shaderProgram);
+        StateBindVertexArray(VAO);
+        PROFILE_GPU_BEGIN("glDrawArrays");
+        for(int i = 0; i < drawsPerFrame; i++)
+        {
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+        }
+        PROFILE_GPU_END("glDrawArrays");
+
+        if(streaming)
+        {
+            BeginStreamFrame(&vertexStream);
+            GLintptr offset = 0;
+            float* streamed = AllocStream(&vertexStream, sizeof(vertices), 6 * sizeof(float), &offset);
+            if(streamed)
+            {
+                // Half size and turned a little more each frame.
+                float c = cosf(frame * 0.02f) * 0.5f;
+                float s = sinf(frame * 0.02f) * 0.5f;
+                memcpy(streamed, vertices, sizeof(vertices));
+                for(int v = 0; v < 3; v++)
+                {
+                    streamed[v * 6 + 0] = vertices[v * 6] * c - vertices[v * 6 + 1] * s;
+                    streamed[v * 6 + 1] = vertices[v * 6] * s + vertices[v * 6 + 1] * c;
+                }
+                FlushStream(&vertexStream);
+                StateBindVertexArray(streamVAO);
+                glDrawArrays(GL_TRIANGLES, (GLint)(offset / (6 * sizeof(float))), 3);
+            }
+        }
+        PROFILE_END("draw");
+
+        PROFILE_BEGIN("CaptureFrame");
+        CaptureFrame(&capture);
+        PROFILE_END("CaptureFrame");
+
+        if (window)
+        {
+            PROFILE_BEGIN("glfwSwapBuffers");
+            glfwSwapBuffers(window);
+            PROFILE_END("glfwSwapBuffers");
+            PROFILE_BEGIN("glfwPollEvents");
+            glfwPollEvents();
+            PROFILE_END("glfwPollEvents");
+        }
+        if(streaming){EndStreamFrame(&vertexStream);}
+        PROFILE_GPU_FRAME();
+        PROFILE_END("frame");
+        EndFrameStats(&frameStats);
+        frame++;
+    }
 
-        glBindVertexArray(VAO);
-        glDrawArrays(GL_TRIANGLES, 0, 3);
+    StopFrameCapture(&capture);
 
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+    FinishFrameStats(&frameStats);
+    LogFrameStats(&frameStats);
+    GLStateStats stateStats;
+    GetStateStats(&stateStats);
+    logInfo(GL, "GL state calls : %llu issued, %llu skipped", stateStats.issued, stateStats.skipped);
+    int result = 0;
+    if(benchmark)
+    {
+        WriteFrameStats(&frameStats, "benchmark.json");
+        if(baseline && CheckFrameStatsBaseline(&frameStats, baseline, tolerance) != 1)
+        {
+            result = 1;
+        }
     }
 
-    glDeleteVertexArrays(1, &VAO);
-    glDeleteBuffers(1, &VBO);
+    StopAssetStreamer(&assets);
+    StateDeleteVertexArrays(1, &VAO);
+    StateDeleteBuffers(1, &VBO);
+    if(streaming)
+    {
+        StateDeleteVertexArrays(1, &streamVAO);
+        DestroyStreamBuffer(&vertexStream);
+    }
     ShaderCleanUp(shaderProgram);
+    PROFILE_GPU_SHUTDOWN();
+    PROFILE_WRITE("trace.json");
+
+#ifdef USE_HEADLESS
+    if(headlessFrames)
+    {
+        SaveHeadlessFrame(&headless, "headless.bmp");
+        StopHeadless(&headless);
+        loggingStopAsync();
+        return result;
+    }
+#endif
 
     glfwTerminate();
-    return 0;
+    loggingStopAsync();
+    return result;
 }
 
 void processInput(GLFWwindow *window)
 {
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, 1);
+
+    static int f12WasDown = 0;
+    int f12Down = (glfwGetKey(window, GLFW_KEY_F12) == GLFW_PRESS);
+    if (f12Down && !f12WasDown)
+    {
+        if (capture.active)
+        {
+            StopFrameCapture(&capture);
+        } else {
+            int width, height;
+            glfwGetFramebufferSize(window, &width, &height);
+            StartFrameCapture(&capture, "capture_%05d.bmp", width, height);
+        }
+    }
+    f12WasDown = f12Down;
 }
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
-    glViewport(0, 0, width, height);
+    // Frames are read back at the size the capture started with.
+    if (capture.active)
+    {
+        StopFrameCapture(&capture);
+        logInfo(WINDOW, "Frame capture stopped, the window was resized");
+    }
+    StateViewport(0, 0, width, height);
 }
@@ -0,0 +1,420 @@
+/*!
+@author ThatOSDev
+@NOTE
+#define PROFILER_IMPLEMENTATION
+#include "profiler.h"
+
+A small CPU profiler. Define USE_PROFILER for the whole build to turn it on, without it every
+PROFILE_ macro is empty and nothing is compiled in. Each thread records into its own ring of
+PROFILER_RING_EVENTS events, the oldest are overwritten. PROFILE_WRITE saves everything as a
+Chrome trace, open it in chrome://tracing or https://ui.perfetto.dev
+
+Scope names are stored as pointers, use string literals.
+
+GPU scopes put a GL_TIMESTAMP query on each side of the GL calls. The results are read back
+PROFILER_GPU_FRAMES frames later, if they aren't ready by then the frame is dropped rather than
+waited on. They show up as a "GPU" thread on the same timeline. Needs GL 3.3 or ARB_timer_query,
+define PROFILER_NO_GPU to leave GL out of it.
+
+EXAMPLE :
+    PROFILE_THREAD("main");
+    while(...)
+    {
+        PROFILE_BEGIN("glfwSwapBuffers");
+        glfwSwapBuffers(window);
+        PROFILE_END("glfwSwapBuffers");
+
+        PROFILE_GPU_BEGIN("glDrawArrays");
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        PROFILE_GPU_END("glDrawArrays");
+        PROFILE_GPU_FRAME();    // Once a frame, reads back old queries.
+    }
+    PROFILE_GPU_SHUTDOWN(); // While the context is still current.
+    PROFILE_WRITE("trace.json");
+*/
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#ifndef PROFILER_RING_EVENTS
+#define PROFILER_RING_EVENTS 65536  // Per thread, must be a power of 2.
+#endif
+
+#ifndef PROFILER_GPU_FRAMES
+#define PROFILER_GPU_FRAMES 4       // Frames of queries in flight.
+#endif
+
+#ifndef PROFILER_GPU_QUERIES
+#define PROFILER_GPU_QUERIES 128    // GPU events per frame.
+#endif
+
+#ifdef USE_PROFILER
+#define PROFILE_BEGIN(name)     ProfileEvent((name), 'B')
+#define PROFILE_END(name)       ProfileEvent((name), 'E')
+#define PROFILE_THREAD(name)    ProfileThreadName(name)
+#define PROFILE_WRITE(fileName) ProfileWriteTrace(fileName)
+#else
+#define PROFILE_BEGIN(name)     ((void)0)
+#define PROFILE_END(name)       ((void)0)
+#define PROFILE_THREAD(name)    ((void)0)
+#define PROFILE_WRITE(fileName) ((void)0)
+#endif
+
+#if defined(USE_PROFILER) && !defined(PROFILER_NO_GPU)
+#define PROFILE_GPU_BEGIN(name) ProfileGpuEvent((name), 'B')
+#define PROFILE_GPU_END(name)   ProfileGpuEvent((name), 'E')
+#define PROFILE_GPU_FRAME()     ProfileGpuFrame()
+#define PROFILE_GPU_SHUTDOWN()  ProfileGpuShutdown()
+#else
+#define PROFILE_GPU_BEGIN(name) ((void)0)
+#define PROFILE_GPU_END(name)   ((void)0)
+#define PROFILE_GPU_FRAME()     ((void)0)
+#define PROFILE_GPU_SHUTDOWN()  ((void)0)
+#endif
+
+/*! @breif
+    This records the start ('B') or end ('E') of a scope on the calling thread.
+	@param[in] The scope name, a string literal.
+	@param[in] 'B' or 'E'.
+*/
+void ProfileEvent(const char* name, char type);
+
+/*! @breif
+    This names the calling thread in the trace.
+	@param[in] The thread name.
+*/
+void ProfileThreadName(const char* name);
+
+/*! @breif
+    This writes every thread's events as Chrome trace JSON. Scopes still open are closed at the
+    thread's last event. Call it when the other threads are idle, e.g. after the main loop.
+	@param[in] This is the path and name of the file to save.
+	@return 1 on success, 0 otherwise.
+*/
+int ProfileWriteTrace(const char* fileName);
+
+/*! @breif
+    Nanoseconds on a monotonic clock.
+*/
+long long ProfileNow(void);
+
+/*! @breif
+    This records a GPU timestamp for the start ('B') or end ('E') of a scope. Needs a current
+    GL context, the first call creates the query pool.
+	@param[in] The scope name, a string literal.
+	@param[in] 'B' or 'E'.
+*/
+void ProfileGpuEvent(const char* name, char type);
+
+/*! @breif
+    This ends the GPU frame. Queries from PROFILER_GPU_FRAMES frames ago are read back if the
+    GPU is done with them, and dropped if it isn't. Never waits.
+*/
+void ProfileGpuFrame(void);
+
+/*! @breif
+    This waits for the queries still in flight, adds them to the trace and deletes the pool.
+*/
+void ProfileGpuShutdown(void);
+
+#endif // PROFILER_H
+
+#if defined(PROFILER_IMPLEMENTATION) && !defined(PROFILER_IMPLEMENTATION_DONE)
+#define PROFILER_IMPLEMENTATION_DONE
+
+#include <stdio.h>   // fopen()  fprintf()
+#include <stdlib.h>  // malloc()
+#include <string.h>  // strncpy()
+#include <time.h>    // clock_gettime()
+#include "thread.h"
+
+#ifdef _MSC_VER
+#define PROFILER_THREAD_LOCAL __declspec(thread)
+#else
+#define PROFILER_THREAD_LOCAL __thread
+#endif
+
+#define PROFILER_MAX_DEPTH 64
+
+typedef struct ProfileRecord
+{
+    const char* name;
+    long long time;
+    char type;
+} ProfileRecord;
+
+typedef struct ProfileRing
+{
+    ProfileRecord* records;
+    unsigned long long count;   // Every event ever recorded, the ring keeps the last PROFILER_RING_EVENTS.
+    int threadId;
+    char threadName[32];
+    struct ProfileRing* next;
+} ProfileRing;
+
+static PROFILER_THREAD_LOCAL ProfileRing* profileThreadRing = NULL;
+static ProfileRing* profileRings = NULL;
+static SpinLock profileLock = 0;
+static int profileThreadCount = 0;
+static long long profileStart = 0;
+
+long long ProfileNow(void)
+{
+#ifdef _WIN32
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+    if(frequency.QuadPart == 0){QueryPerformanceFrequency(&frequency);}
+    QueryPerformanceCounter(&counter);
+    return (long long)((double)counter.QuadPart * 1000000000.0 / (double)frequency.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000ll + ts.tv_nsec;
+#endif
+}
+
+static ProfileRing* profileCreateRing(const char* name)
+{
+    ProfileRing* ring = (ProfileRing*)calloc(1, sizeof(ProfileRing));
+    if(ring == NULL){return NULL;}
+    ring->records = (ProfileRecord*)malloc(sizeof(ProfileRecord) * PROFILER_RING_EVENTS);
+    if(ring->records == NULL)
+    {
+        free(ring);
+        return NULL;
+    }
+
+    SpinLockAcquire(&profileLock);
+    if(profileStart == 0){profileStart = ProfileNow();}
+    ring->threadId = ++profileThreadCount;
+    if(name)
+    {
+        strncpy(ring->threadName, name, sizeof(ring->threadName) - 1);
+    } else {
+        snprintf(ring->threadName, sizeof(ring->threadName), "thread %d", ring->threadId);
+    }
+    ring->next = profileRings;
+    profileRings = ring;
+    SpinLockRelease(&profileLock);
+    return ring;
+}
+
+static ProfileRing* profileRegisterThread(void)
+{
+    profileThreadRing = profileCreateRing(NULL);
+    return profileThreadRing;
+}
+
+static void profileAdd(ProfileRing* ring, const char* name, char type, long long time)
+{
+    ProfileRecord* record = &ring->records[ring->count & (PROFILER_RING_EVENTS - 1)];
+    record->name = name;
+    record->type = type;
+    record->time = time;
+    ring->count++;
+}
+
+void ProfileEvent(const char* name, char type)
+{
+    ProfileRing* ring = profileThreadRing;
+    if(ring == NULL)
+    {
+        ring = profileRegisterThread();
+        if(ring == NULL){return;}
+    }
+    profileAdd(ring, name, type, ProfileNow());
+}
+
+void ProfileThreadName(const char* name)
+{
+    ProfileRing* ring = profileThreadRing;
+    if(ring == NULL)
+    {
+        ring = profileRegisterThread();
+        if(ring == NULL){return;}
+    }
+    strncpy(ring->threadName, name, sizeof(ring->threadName) - 1);
+}
+
+static void profileWriteName(FILE* file, const char* name)
+{
+    fputc('"', file);
+    for(; *name != '\0'; name++)
+    {
+        if(*name == '"' || *name == '\\'){fputc('\\', file);}
+        if((unsigned char)*name >= 0x20){fputc(*name, file);}
+    }
+    fputc('"', file);
+}
+
+static void profileWriteEvent(FILE* file, int* first, const char* name, char type, long long time, int threadId)
+{
+    fprintf(file, "%s\n{\"name\":", *first ? "" : ",");
+    profileWriteName(file, name);
+    fprintf(file, ",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":1,\"tid\":%d}", type, (double)(time - profileStart) / 1000.0, threadId);
+    *first = 0;
+}
+
+int ProfileWriteTrace(const char* fileName)
+{
+    FILE* file = fopen(fileName, "w");
+    if(file == NULL){return 0;}
+
+    SpinLockAcquire(&profileLock);
+    ProfileRing* rings = profileRings;
+    SpinLockRelease(&profileLock);
+
+    int first = 1;
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    for(ProfileRing* ring = rings; ring != NULL; ring = ring->next)
+    {
+        fprintf(file, "%s\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":", first ? "" : ",", ring->threadId);
+        profileWriteName(file, ring->threadName);
+        fprintf(file, "}}");
+        first = 0;
+
+        unsigned long long count = ring->count;
+        unsigned long long start = (count > PROFILER_RING_EVENTS) ? count - PROFILER_RING_EVENTS : 0;
+        const char* open[PROFILER_MAX_DEPTH];
+        int depth = 0;
+        long long last = 0;
+        for(unsigned long long i = start; i < count; i++)
+        {
+            const ProfileRecord* record = &ring->records[i & (PROFILER_RING_EVENTS - 1)];
+            last = record->time;
+            if(record->type == 'B')
+            {
+                if(depth < PROFILER_MAX_DEPTH){open[depth] = record->name;}
+                depth++;
+            } else {
+                if(depth == 0){continue;}  // Its start was overwritten.
+                depth--;
+            }
+            profileWriteEvent(file, &first, record->name, record->type, record->time, ring->threadId);
+        }
+        while(depth > 0)
+        {
+            depth--;
+            profileWriteEvent(file, &first, depth < PROFILER_MAX_DEPTH ? open[depth] : "", 'E', last, ring->threadId);
+        }
+    }
+    fprintf(file, "\n]}\n");
+    return fclose(file) == 0;
+}
+
+#ifndef PROFILER_NO_GPU
+#include <glad/gl.h>
+
+typedef struct ProfileGpuQueries
+{
+    GLuint queries[PROFILER_GPU_QUERIES];
+    const char* names[PROFILER_GPU_QUERIES];
+    char types[PROFILER_GPU_QUERIES];
+    int count;
+} ProfileGpuQueries;
+
+static ProfileGpuQueries profileGpu[PROFILER_GPU_FRAMES];
+static ProfileRing* profileGpuRing = NULL;
+static int profileGpuState = 0;          // 0 not set up, 1 running, -1 no timer queries.
+static int profileGpuFrame = 0;
+static int profileGpuFrames = 0;
+static long long profileGpuOffset = 0;   // Add to a GPU timestamp to get ProfileNow() time.
+
+static void profileGpuCalibrate(void)
+{
+    GLint64 gpu = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpu);
+    profileGpuOffset = ProfileNow() - (long long)gpu;
+}
+
+static int profileGpuSetup(void)
+{
+    if(!(GLAD_GL_VERSION_3_3 || GLAD_GL_ARB_timer_query))
+    {
+        profileGpuState = -1;
+        return 0;
+    }
+    profileGpuRing = profileCreateRing("GPU");
+    if(profileGpuRing == NULL)
+    {
+        profileGpuState = -1;
+        return 0;
+    }
+    for(int i = 0; i < PROFILER_GPU_FRAMES; i++)
+    {
+        glGenQueries(PROFILER_GPU_QUERIES, profileGpu[i].queries);
+        profileGpu[i].count = 0;
+    }
+    profileGpuCalibrate();
+    profileGpuState = 1;
+    return 1;
+}
+
+static int profileGpuCollect(ProfileGpuQueries* frame, int wait)
+{
+    if(frame->count == 0){return 1;}
+    if(!wait)
+    {
+        // Timestamps finish in order, if the last one is there they all are.
+        GLint available = 0;
+        glGetQueryObjectiv(frame->queries[frame->count - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if(!available)
+        {
+            frame->count = 0;
+            return 0;
+        }
+    }
+    for(int i = 0; i < frame->count; i++)
+    {
+        GLuint64 time = 0;
+        glGetQueryObjectui64v(frame->queries[i], GL_QUERY_RESULT, &time);
+        profileAdd(profileGpuRing, frame->names[i], frame->types[i], (long long)time + profileGpuOffset);
+    }
+    frame->count = 0;
+    return 1;
+}
+
+void ProfileGpuEvent(const char* name, char type)
+{
+    if(profileGpuState == 0){profileGpuSetup();}
+    if(profileGpuState < 0){return;}
+
+    ProfileGpuQueries* frame = &profileGpu[profileGpuFrame];
+    if(frame->count >= PROFILER_GPU_QUERIES){return;}
+    glQueryCounter(frame->queries[frame->count], GL_TIMESTAMP);
+    frame->names[frame->count] = name;
+    frame->types[frame->count] = type;
+    frame->count++;
+}
+
+void ProfileGpuFrame(void)
+{
+    if(profileGpuState <= 0){return;}
+
+    // Make sure this frame's queries are submitted, nothing else does it without a swap.
+    glFlush();
+
+    // The next slot was filled PROFILER_GPU_FRAMES - 1 frames ago.
+    profileGpuFrame = (profileGpuFrame + 1) % PROFILER_GPU_FRAMES;
+    profileGpuCollect(&profileGpu[profileGpuFrame], 0);
+
+    // The two clocks drift apart slowly, line them up again now and then.
+    if(++profileGpuFrames % 256 == 0){profileGpuCalibrate();}
+}
+
+void ProfileGpuShutdown(void)
+{
+    if(profileGpuState <= 0){return;}
+    for(int i = 1; i <= PROFILER_GPU_FRAMES; i++)
+    {
+        profileGpuCollect(&profileGpu[(profileGpuFrame + i) % PROFILER_GPU_FRAMES], 1);
+    }
+    for(int i = 0; i < PROFILER_GPU_FRAMES; i++)
+    {
+        glDeleteQueries(PROFILER_GPU_QUERIES, profileGpu[i].queries);
+    }
+    profileGpuState = 0;
+}
+#endif // PROFILER_NO_GPU
+
+#endif // PROFILER_IMPLEMENTATION
@@ -0,0 +1,258 @@
+/*!
+@author ThatOSDev
+@NOTE
+#define RENDERQUEUE_IMPLEMENTATION
+#include "renderqueue.h"
+
+Draws are submitted in any order with a 64 bit sort key, radix sorted once per frame and then
+drawn so that draws sharing a program, texture and VAO follow each other. State goes through
+glstate.h, so only real changes reach GL.
+
+Key, high bits first :
+    pass 4 | program 12 | texture 16 | VAO 12 | depth 20             MakeRenderKey
+    pass 4 | depth 20 (far first) | program 12 | texture 16 | VAO 12 MakeRenderKeyBackToFront
+GL names are cut to their field. That only costs some grouping, each item keeps its real names.
+
+EXAMPLE :
+    RenderQueue queue;
+    CreateRenderQueue(&queue, 10000);
+    while(...)
+    {
+        ClearRenderQueue(&queue);
+        RenderItem item = {0};
+        item.program = program;  item.texture = texture;  item.vao = VAO;
+        item.mode = GL_TRIANGLES;  item.count = 36;
+        item.key = MakeRenderKey(0, program, texture, VAO, depth);
+        SubmitRenderItem(&queue, &item);
+        SortRenderQueue(&queue);
+        DrawRenderQueue(&queue);
+    }
+    DestroyRenderQueue(&queue);
+*/
+
+#ifndef RENDERQUEUE_H
+#define RENDERQUEUE_H
+
+#include <glad/gl.h>
+#include <stdint.h>  // uint64_t
+
+typedef struct RenderItem RenderItem;
+
+// Called right before an item is drawn, for per-draw uniforms.
+typedef void (*RenderItemFunc)(const RenderItem* item);
+
+struct RenderItem
+{
+    uint64_t key;
+    GLuint program;
+    GLuint texture;     // GL_TEXTURE_2D on unit 0, 0 for none.
+    GLuint vao;
+    GLenum mode;
+    GLint first;        // First vertex, or the byte offset into the index buffer when indexType is set.
+    GLsizei count;
+    GLenum indexType;   // 0 for glDrawArrays.
+    RenderItemFunc setup;
+    void* data;
+};
+
+typedef struct RenderQueue
+{
+    RenderItem* items;
+    uint64_t* keys;
+    uint32_t* order;    // Item indices, sorted by SortRenderQueue.
+    uint64_t* keyTemp;
+    uint32_t* orderTemp;
+    int count;
+    int capacity;
+} RenderQueue;
+
+/*! @breif
+    This builds a key that groups by state inside a pass, nearest first within the same state.
+	@param[in] The pass, 0 to 15. Lower passes draw first.
+	@param[in] The program.
+	@param[in] The texture.
+	@param[in] The VAO.
+	@param[in] The depth, 0 near to 1 far.
+	@return The sort key.
+*/
+uint64_t MakeRenderKey(unsigned int pass, GLuint program, GLuint texture, GLuint vao, float depth);
+
+/*! @breif
+    This builds a key that sorts far to near inside a pass, for blending. State only breaks ties.
+*/
+uint64_t MakeRenderKeyBackToFront(unsigned int pass, GLuint program, GLuint texture, GLuint vao, float depth);
+
+int  CreateRenderQueue(RenderQueue* queue, int capacity);
+void ClearRenderQueue(RenderQueue* queue);
+
+/*! @breif
+    This queues a draw, the item is copied.
+	@return 1 on success, 0 when the queue is full.
+*/
+int  SubmitRenderItem(RenderQueue* queue, const RenderItem* item);
+
+/*! @breif
+    This sorts the queued items by key. Items with the same key keep their submission order.
+	@param[in] The queue.
+*/
+void SortRenderQueue(RenderQueue* queue);
+
+/*! @breif
+    This draws the queued items, in sorted order after SortRenderQueue, else as submitted.
+	@param[in] The queue.
+*/
+void DrawRenderQueue(RenderQueue* queue);
+void DestroyRenderQueue(RenderQueue* queue);
+
+#endif // RENDERQUEUE_H
+
+#if defined(RENDERQUEUE_IMPLEMENTATION) && !defined(RENDERQUEUE_IMPLEMENTATION_DONE)
+#define RENDERQUEUE_IMPLEMENTATION_DONE
+
+#include <stdlib.h>  // malloc()  free()
+#include <string.h>  // memset()
+#include "profiler.h"
+#include "glstate.h"
+#include "logging.h"
+
+static uint64_t renderDepthBits(float depth)
+{
+    if(depth < 0.0f){depth = 0.0f;}
+    if(depth > 1.0f){depth = 1.0f;}
+    return (uint64_t)(depth * (float)0xFFFFF);
+}
+
+uint64_t MakeRenderKey(unsigned int pass, GLuint program, GLuint texture, GLuint vao, float depth)
+{
+    return ((uint64_t)(pass & 0xF) << 60) |
+           ((uint64_t)(program & 0xFFF) << 48) |
+           ((uint64_t)(texture & 0xFFFF) << 32) |
+           ((uint64_t)(vao & 0xFFF) << 20) |
+           renderDepthBits(depth);
+}
+
+uint64_t MakeRenderKeyBackToFront(unsigned int pass, GLuint program, GLuint texture, GLuint vao, float depth)
+{
+    return ((uint64_t)(pass & 0xF) << 60) |
+           ((0xFFFFF - renderDepthBits(depth)) << 40) |
+           ((uint64_t)(program & 0xFFF) << 28) |
+           ((uint64_t)(texture & 0xFFFF) << 12) |
+           (uint64_t)(vao & 0xFFF);
+}
+
+int CreateRenderQueue(RenderQueue* queue, int capacity)
+{
+    memset(queue, 0, sizeof(RenderQueue));
+    queue->items = (RenderItem*)malloc(sizeof(RenderItem) * (size_t)capacity);
+    queue->keys = (uint64_t*)malloc(sizeof(uint64_t) * (size_t)capacity);
+    queue->order = (uint32_t*)malloc(sizeof(uint32_t) * (size_t)capacity);
+    queue->keyTemp = (uint64_t*)malloc(sizeof(uint64_t) * (size_t)capacity);
+    queue->orderTemp = (uint32_t*)malloc(sizeof(uint32_t) * (size_t)capacity);
+    if(!queue->items || !queue->keys || !queue->order || !queue->keyTemp || !queue->orderTemp)
+    {
+        logError(GL, "Unable to allocate a render queue of %d items", capacity);
+        DestroyRenderQueue(queue);
+        return 0;
+    }
+    queue->capacity = capacity;
+    return 1;
+}
+
+void ClearRenderQueue(RenderQueue* queue)
+{
+    queue->count = 0;
+}
+
+int SubmitRenderItem(RenderQueue* queue, const RenderItem* item)
+{
+    if(queue->count >= queue->capacity)
+    {
+        logError(GL, "Render queue is full (%d items)", queue->capacity);
+        return 0;
+    }
+    queue->items[queue->count] = *item;
+    queue->keys[queue->count] = item->key;
+    queue->order[queue->count] = (uint32_t)queue->count;
+    queue->count++;
+    return 1;
+}
+
+// LSD radix sort on 8 bit digits, stable. A digit that is the same in every key is skipped, so
+// unused fields (one pass, few programs) cost nothing.
+void SortRenderQueue(RenderQueue* queue)
+{
+    PROFILE_BEGIN("SortRenderQueue");
+    int count = queue->count;
+    uint64_t* keys = queue->keys;
+    uint32_t* order = queue->order;
+    uint64_t* keyTemp = queue->keyTemp;
+    uint32_t* orderTemp = queue->orderTemp;
+
+    uint32_t histograms[8][256];
+    memset(histograms, 0, sizeof(histograms));
+    for(int i = 0; i < count; i++)
+    {
+        uint64_t key = keys[i];
+        for(int d = 0; d < 8; d++){histograms[d][(key >> (d * 8)) & 0xFF]++;}
+    }
+
+    for(int d = 0; d < 8; d++)
+    {
+        uint32_t* histogram = histograms[d];
+        if(count == 0 || histogram[(keys[0] >> (d * 8)) & 0xFF] == (uint32_t)count){continue;}
+
+        uint32_t offset = 0;
+        for(int b = 0; b < 256; b++)
+        {
+            uint32_t n = histogram[b];
+            histogram[b] = offset;
+            offset += n;
+        }
+        for(int i = 0; i < count; i++)
+        {
+            uint32_t slot = histogram[(keys[i] >> (d * 8)) & 0xFF]++;
+            keyTemp[slot] = keys[i];
+            orderTemp[slot] = order[i];
+        }
+        uint64_t* swapKeys = keys;   keys = keyTemp;   keyTemp = swapKeys;
+        uint32_t* swapOrder = order; order = orderTemp; orderTemp = swapOrder;
+    }
+
+    queue->keys = keys;
+    queue->order = order;
+    queue->keyTemp = keyTemp;
+    queue->orderTemp = orderTemp;
+    PROFILE_END("SortRenderQueue");
+}
+
+void DrawRenderQueue(RenderQueue* queue)
+{
+    PROFILE_BEGIN("DrawRenderQueue");
+    for(int i = 0; i < queue->count; i++)
+    {
+        const RenderItem* item = &queue->items[queue->order[i]];
+        StateUseProgram(item->program);
+        StateBindTexture(0, GL_TEXTURE_2D, item->texture);
+        StateBindVertexArray(item->vao);
+        if(item->setup){item->setup(item);}
+        if(item->indexType)
+        {
+            glDrawElements(item->mode, item->count, item->indexType, (const void*)(intptr_t)item->first);
+        } else {
+            glDrawArrays(item->mode, item->first, item->count);
+        }
+    }
+    PROFILE_END("DrawRenderQueue");
+}
+
+void DestroyRenderQueue(RenderQueue* queue)
+{
+    free(queue->items);
+    free(queue->keys);
+    free(queue->order);
+    free(queue->keyTemp);
+    free(queue->orderTemp);
+    memset(queue, 0, sizeof(RenderQueue));
+}
+
+#endif // RENDERQUEUE_IMPLEMENTATION
@@ -8,6 +8,9 @@
 #include <stdbool.h>
 #include <stdio.h>         // printf()   FILE*
 #include <stdlib.h>        // malloc()
+#include <string.h>        // strcmp()  strlen()  memcpy()
+#include "profiler.h"
+#include "glstate.h"   // Define GLSTATE_IMPLEMENTATION once in the project.
 
 unsigned int LoadEmbeddedShaders(const char* vertex_shader_text, const char* fragment_shader_text);
 unsigned int LoadShaders(const char* vertexPath, const char* fragmentPath);
@@ -18,73 +21,414 @@ void setFloat(unsigned int programID, const char* name, float value);
 int  loadShaderFromFile(const char* fileName, int shaderType);
 void checkCompileErrors(unsigned int shader);
 void ShaderCleanUp(unsigned int programID);
+void cacheUniformLocations(unsigned int programID);
+void forgetUniformLocations(unsigned int programID);
+int  getUniformLocation(unsigned int programID, const char* name);
+void getShaderCacheStats(int* hits, int* misses);
+
+// Uniform location cache. Every program's active uniforms are added when it links, so the
+// setters below never ask the driver to look a name up. Open addressing, linear probing.
+#ifndef SHADER_UNIFORM_CACHE_SIZE
+#define SHADER_UNIFORM_CACHE_SIZE 4096  // Must be a power of 2.
+#endif
+#define SHADER_UNIFORM_NAME_MAX 64
+
+#define UNIFORM_SLOT_EMPTY   0
+#define UNIFORM_SLOT_USED    1
+#define UNIFORM_SLOT_DELETED 2
+
+typedef struct UniformCacheEntry
+{
+    unsigned int program;
+    unsigned int hash;
+    int location;
+    int state;
+    char name[SHADER_UNIFORM_NAME_MAX];
+} UniformCacheEntry;
+
+static UniformCacheEntry uniformCache[SHADER_UNIFORM_CACHE_SIZE];
+static int uniformCacheCount = 0;
+static int uniformCacheDeleted = 0;
+
+static unsigned int uniformHash(unsigned int programID, const char* name)
+{
+    unsigned int hash = 2166136261u ^ (programID * 16777619u);
+    while(*name)
+    {
+        hash ^= (unsigned char)*name++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static UniformCacheEntry* findUniform(unsigned int programID, const char* name, unsigned int hash)
+{
+    unsigned int mask = SHADER_UNIFORM_CACHE_SIZE - 1;
+    for(unsigned int i = 0; i < SHADER_UNIFORM_CACHE_SIZE; i++)
+    {
+        UniformCacheEntry* entry = &uniformCache[(hash + i) & mask];
+        if(entry->state == UNIFORM_SLOT_EMPTY){return NULL;}
+        if(entry->state == UNIFORM_SLOT_USED && entry->hash == hash && entry->program == programID && strcmp(entry->name, name) == 0)
+        {
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+static void addUniform(unsigned int programID, const char* name, int location)
+{
+    size_t length = strlen(name);
+    // Keep the table under 3/4 full so misses stay short. Long names just skip the cache.
+    if(length >= SHADER_UNIFORM_NAME_MAX || uniformCacheCount >= (SHADER_UNIFORM_CACHE_SIZE / 4) * 3){return;}
+
+    unsigned int hash = uniformHash(programID, name);
+    if(findUniform(programID, name, hash)){return;}
+
+    unsigned int mask = SHADER_UNIFORM_CACHE_SIZE - 1;
+    for(unsigned int i = 0; i < SHADER_UNIFORM_CACHE_SIZE; i++)
+    {
+        UniformCacheEntry* entry = &uniformCache[(hash + i) & mask];
+        if(entry->state != UNIFORM_SLOT_USED)
+        {
+            if(entry->state == UNIFORM_SLOT_DELETED){uniformCacheDeleted--;}
+            entry->program = programID;
+            entry->hash = hash;
+            entry->location = location;
+            entry->state = UNIFORM_SLOT_USED;
+            memcpy(entry->name, name, length + 1);
+            uniformCacheCount++;
+            return;
+        }
+    }
+}
+
+void cacheUniformLocations(unsigned int programID)
+{
+    GLint count = 0;
+    char name[SHADER_UNIFORM_NAME_MAX];
+    glGetProgramiv(programID, GL_ACTIVE_UNIFORMS, &count);
+    for(GLint i = 0; i < count; i++)
+    {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(programID, (GLuint)i, sizeof(name), &length, &size, &type, name);
+        if(length <= 0 || length >= SHADER_UNIFORM_NAME_MAX - 1){continue;}
+
+        int location = glGetUniformLocation(programID, name);
+        addUniform(programID, name, location);
+
+        // Arrays come back as "name[0]", so "name" gets cached too.
+        if(length > 3 && strcmp(name + length - 3, "[0]") == 0)
+        {
+            name[length - 3] = 0;
+            addUniform(programID, name, location);
+        }
+    }
+}
+
+// Deleted slots only end a probe at an empty one, so once they pile up every miss walks the
+// whole table. The live entries are put back into a clean table instead.
+static void rehashUniformCache(void)
+{
+    UniformCacheEntry* live = NULL;
+    if(uniformCacheCount > 0)
+    {
+        live = (UniformCacheEntry*)malloc(sizeof(UniformCacheEntry) * uniformCacheCount);
+        if(live == NULL){return;}
+    }
+    int count = 0;
+    for(int i = 0; i < SHADER_UNIFORM_CACHE_SIZE; i++)
+    {
+        if(uniformCache[i].state == UNIFORM_SLOT_USED){live[count++] = uniformCache[i];}
+    }
+    memset(uniformCache, 0, sizeof(uniformCache));
+    uniformCacheCount = 0;
+    uniformCacheDeleted = 0;
+    for(int i = 0; i < count; i++)
+    {
+        addUniform(live[i].program, live[i].name, live[i].location);
+    }
+    free(live);
+}
+
+void forgetUniformLocations(unsigned int programID)
+{
+    for(int i = 0; i < SHADER_UNIFORM_CACHE_SIZE; i++)
+    {
+        if(uniformCache[i].state == UNIFORM_SLOT_USED && uniformCache[i].program == programID)
+        {
+            uniformCache[i].state = UNIFORM_SLOT_DELETED;
+            uniformCacheCount--;
+            uniformCacheDeleted++;
+        }
+    }
+    if(uniformCacheDeleted > 0 && (uniformCacheCount == 0 || uniformCacheDeleted > SHADER_UNIFORM_CACHE_SIZE / 4))
+    {
+        rehashUniformCache();
+    }
+}
+
+int getUniformLocation(unsigned int programID, const char* name)
+{
+    unsigned int hash = uniformHash(programID, name);
+    UniformCacheEntry* entry = findUniform(programID, name, hash);
+    if(entry){return entry->location;}
+
+    // Names that were not enumerated ("light[3]", typos) are asked for once, then cached.
+    int location = glGetUniformLocation(programID, name);
+    addUniform(programID, name, location);
+    return location;
+}
 
 void useShader(unsigned int programID)
 {
-    glUseProgram(programID);
+    StateUseProgram(programID);
 }
 
 void setBool(unsigned int programID, const char* name, bool value)
 {
-    glUniform1i(glGetUniformLocation(programID, name), (int)value);
+    glUniform1i(getUniformLocation(programID, name), (int)value);
 }
 
 void setInt(unsigned int programID, const char* name, int value)
 {
-    glUniform1i(glGetUniformLocation(programID, name), value);
+    glUniform1i(getUniformLocation(programID, name), value);
 }
 
 void setFloat(unsigned int programID, const char* name, float value)
 {
-    glUniform1f(glGetUniformLocation(programID, name), value);
+    glUniform1f(getUniformLocation(programID, name), value);
 }
 
 void setVec2(unsigned int programID, const char* name, const vec2 value)
 {
-    glUniform2fv(glGetUniformLocation(programID, name), 1, &value[0]);
+    glUniform2fv(getUniformLocation(programID, name), 1, &value[0]);
 }
 
 void setVec2_XY(unsigned int programID, const char* name, float x, float y)
 {
-    glUniform2f(glGetUniformLocation(programID, name), x, y);
+    glUniform2f(getUniformLocation(programID, name), x, y);
 }
 
 void setVec3(unsigned int programID, const char* name, const vec3 value)
 {
-    glUniform3fv(glGetUniformLocation(programID, name), 1, &value[0]);
+    glUniform3fv(getUniformLocation(programID, name), 1, &value[0]);
 }
 
 void setVec3_XYZ(unsigned int programID, const char* name, float x, float y, float z)
 {
-    glUniform3f(glGetUniformLocation(programID, name), x, y, z);
+    glUniform3f(getUniformLocation(programID, name), x, y, z);
 }
 
 void setVec4(unsigned int programID, const char* name, const vec4 value)
 {
-    glUniform4fv(glGetUniformLocation(programID, name), 1, &value[0]);
+    glUniform4fv(getUniformLocation(programID, name), 1, &value[0]);
 }
 
 void setVec4_XYZW(unsigned int programID, const char* name, float x, float y, float z, float w)
 {
-    glUniform4f(glGetUniformLocation(programID, name), x, y, z, w);
+    glUniform4f(getUniformLocation(programID, name), x, y, z, w);
 }
 
 void setMat2(unsigned int programID, const char* name, const mat2 mat)
 {
-    glUniformMatrix2fv(glGetUniformLocation(programID, name), 1, GL_FALSE, &mat[0][0]);
+    glUniformMatrix2fv(getUniformLocation(programID, name), 1, GL_FALSE, &mat[0][0]);
 }
 
 void setMat3(unsigned int programID, const char* name, const mat3 mat)
 {
-    glUniformMatrix3fv(glGetUniformLocation(programID, name), 1, GL_FALSE, &mat[0][0]);
+    glUniformMatrix3fv(getUniformLocation(programID, name), 1, GL_FALSE, &mat[0][0]);
 }
 
 void setMat4(unsigned int programID, const char* name, const mat4 mat)
 {
-    glUniformMatrix4fv(glGetUniformLocation(programID, name), 1, GL_FALSE, &mat[0][0]);
+    glUniformMatrix4fv(getUniformLocation(programID, name), 1, GL_FALSE, &mat[0][0]);
 }
 
-unsigned int LoadEmbeddedShaders(const char* vertex_shader_text, const char* fragment_shader_text)
+// These take a location from getUniformLocation() and skip the name lookup entirely.
+void setBoolLoc(int location, bool value)
+{
+    glUniform1i(location, (int)value);
+}
+
+void setIntLoc(int location, int value)
+{
+    glUniform1i(location, value);
+}
+
+void setFloatLoc(int location, float value)
+{
+    glUniform1f(location, value);
+}
+
+void setVec2Loc(int location, const vec2 value)
+{
+    glUniform2fv(location, 1, &value[0]);
+}
+
+void setVec2Loc_XY(int location, float x, float y)
+{
+    glUniform2f(location, x, y);
+}
+
+void setVec3Loc(int location, const vec3 value)
+{
+    glUniform3fv(location, 1, &value[0]);
+}
+
+void setVec3Loc_XYZ(int location, float x, float y, float z)
+{
+    glUniform3f(location, x, y, z);
+}
+
+void setVec4Loc(int location, const vec4 value)
+{
+    glUniform4fv(location, 1, &value[0]);
+}
+
+void setVec4Loc_XYZW(int location, float x, float y, float z, float w)
+{
+    glUniform4f(location, x, y, z, w);
+}
+
+void setMat2Loc(int location, const mat2 mat)
+{
+    glUniformMatrix2fv(location, 1, GL_FALSE, &mat[0][0]);
+}
+
+void setMat3Loc(int location, const mat3 mat)
+{
+    glUniformMatrix3fv(location, 1, GL_FALSE, &mat[0][0]);
+}
+
+void setMat4Loc(int location, const mat4 mat)
+{
+    glUniformMatrix4fv(location, 1, GL_FALSE, &mat[0][0]);
+}
+
+// Binary program cache. Linked programs are saved with glGetProgramBinary and loaded back with
+// glProgramBinary on the next launch. The key hashes both sources plus the driver's vendor,
+// renderer and version strings, so a driver update just turns into misses.
+// Define SHADER_NO_BINARY_CACHE to turn it off.
+#ifndef SHADER_CACHE_PREFIX
+#define SHADER_CACHE_PREFIX "shadercache-"
+#endif
+#define SHADER_CACHE_MAGIC 0x42504C47u  // "GLPB"
+
+static int shaderCacheHits = 0;
+static int shaderCacheMisses = 0;
+
+void getShaderCacheStats(int* hits, int* misses)
+{
+    *hits = shaderCacheHits;
+    *misses = shaderCacheMisses;
+}
+
+static unsigned long long shaderHash(unsigned long long hash, const char* text)
+{
+    if(text == NULL){text = "";}
+    while(*text)
+    {
+        hash ^= (unsigned char)*text++;
+        hash *= 1099511628211ull;
+    }
+    return (hash ^ 0xff) * 1099511628211ull; // Separator, so "ab"+"c" != "a"+"bc".
+}
+
+static int shaderCacheAvailable(void)
+{
+#ifdef SHADER_NO_BINARY_CACHE
+    return 0;
+#else
+    if(!GLAD_GL_VERSION_4_1 && !GLAD_GL_ARB_get_program_binary){return 0;}
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    return formats > 0;
+#endif
+}
+
+static unsigned long long shaderCacheKey(const char* vertex_shader_text, const char* fragment_shader_text)
+{
+    unsigned long long hash = 14695981039346656037ull;
+    hash = shaderHash(hash, vertex_shader_text);
+    hash = shaderHash(hash, fragment_shader_text);
+    hash = shaderHash(hash, (const char*)glGetString(GL_VENDOR));
+    hash = shaderHash(hash, (const char*)glGetString(GL_RENDERER));
+    hash = shaderHash(hash, (const char*)glGetString(GL_VERSION));
+    return hash;
+}
+
+static void shaderCacheFileName(char* fileName, size_t size, unsigned long long key)
+{
+    snprintf(fileName, size, "%s%016llx.bin", SHADER_CACHE_PREFIX, key);
+}
+
+static unsigned int loadProgramBinary(unsigned long long key)
+{
+    char fileName[256];
+    shaderCacheFileName(fileName, sizeof(fileName), key);
+    FILE* file = fopen(fileName, "rb");
+    if(file == NULL){return 0;}
+
+    unsigned int header[2];          // magic, format
+    unsigned long long storedKey;
+    unsigned int length;
+    unsigned int program = 0;
+    if(fread(header, sizeof(header), 1, file) == 1 && fread(&storedKey, sizeof(storedKey), 1, file) == 1 &&
+       fread(&length, sizeof(length), 1, file) == 1 && header[0] == SHADER_CACHE_MAGIC && storedKey == key)
+    {
+        void* binary = malloc(length);
+        if(binary != NULL && fread(binary, 1, length, file) == length)
+        {
+            program = glCreateProgram();
+            glProgramBinary(program, (GLenum)header[1], binary, (GLsizei)length);
+            GLint success = 0;
+            glGetProgramiv(program, GL_LINK_STATUS, &success);
+            if(!success)
+            {
+                // The driver refused it, most likely stale. It gets rebuilt and overwritten.
+                glDeleteProgram(program);
+                program = 0;
+            }
+        }
+        free(binary);
+    }
+    fclose(file);
+    return program;
+}
+
+static void saveProgramBinary(unsigned int program, unsigned long long key)
+{
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if(length <= 0){return;}
+
+    void* binary = malloc((size_t)length);
+    if(binary == NULL){return;}
+    GLenum format = 0;
+    glGetProgramBinary(program, length, NULL, &format, binary);
+
+    char fileName[256];
+    shaderCacheFileName(fileName, sizeof(fileName), key);
+    FILE* file = fopen(fileName, "wb");
+    if(file != NULL)
+    {
+        unsigned int header[2] = {SHADER_CACHE_MAGIC, (unsigned int)format};
+        unsigned int size = (unsigned int)length;
+        fwrite(header, sizeof(header), 1, file);
+        fwrite(&key, sizeof(key), 1, file);
+        fwrite(&size, sizeof(size), 1, file);
+        fwrite(binary, 1, size, file);
+        fclose(file);
+    } else {
+        logError(SHADER, "Unable to write shader cache file : %s", fileName);
+    }
+    free(binary);
+}
+
+static unsigned int compileProgram(const char* vertex_shader_text, const char* fragment_shader_text, const char* vertexName, const char* fragmentName, int retrievable)
 {
     GLuint vertex_shader, fragment_shader, program;
 
@@ -98,7 +442,8 @@ unsigned int LoadEmbeddedShaders(const char* vertex_shader_text, const char* fra
     if(!success)
     {
         glGetShaderInfoLog(vertex_shader, 512, NULL, infoLog);
-        logging("ERROR : SHADER->VERTEX - COMPILATION_FAILED\n%s", infoLog);
+        if(vertexName){logError(SHADER, "%s -->   %s\n", vertexName, infoLog);}
+        else{logError(SHADER, "VERTEX - COMPILATION_FAILED\n%s", infoLog);}
     }
 
     fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
@@ -108,41 +453,303 @@ unsigned int LoadEmbeddedShaders(const char* vertex_shader_text, const char* fra
     if(!success)
     {
         glGetShaderInfoLog(fragment_shader, 512, NULL, infoLog);
-        logging("ERROR : SHADER->FRAGMENT - COMPILATION_FAILED\n%s", infoLog);
+        if(fragmentName){logError(SHADER, "%s -->   %s\n", fragmentName, infoLog);}
+        else{logError(SHADER, "FRAGMENT - COMPILATION_FAILED\n%s", infoLog);}
     }
 
     program = glCreateProgram();
     glAttachShader(program, vertex_shader);
     glAttachShader(program, fragment_shader);
+    if(retrievable)
+    {
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
     glLinkProgram(program);
     glGetProgramiv(program, GL_LINK_STATUS, &success);
     if(!success)
     {
         glGetProgramInfoLog(program, 512, NULL, infoLog);
-        logging("ERROR : SHADER->PROGRAM - LINKING_FAILED\n%s", infoLog);
+        logError(SHADER, "PROGRAM - LINKING_FAILED\n%s", infoLog);
     }
     glDeleteShader(vertex_shader);
     glDeleteShader(fragment_shader);
     return program;
 }
 
-unsigned int LoadShaders(const char* vertexPath, const char* fragmentPath)
+static unsigned int loadProgram(const char* vertex_shader_text, const char* fragment_shader_text, const char* vertexName, const char* fragmentName)
 {
-    unsigned int programID;
-    unsigned int vertex = loadShaderFromFile(vertexPath, GL_VERTEX_SHADER);
-    unsigned int fragment = loadShaderFromFile(fragmentPath, GL_FRAGMENT_SHADER);
+    int useCache = shaderCacheAvailable();
+    unsigned long long key = 0;
+    unsigned int program = 0;
+
+    if(useCache)
+    {
+        key = shaderCacheKey(vertex_shader_text, fragment_shader_text);
+        program = loadProgramBinary(key);
+        if(program)
+        {
+            shaderCacheHits++;
+            cacheUniformLocations(program);
+            return program;
+        }
+        shaderCacheMisses++;
+    }
 
-    programID = glCreateProgram();
-    glAttachShader(programID, vertex);
-    glAttachShader(programID, fragment);
-    glLinkProgram(programID);
-    checkCompileErrors(programID);
+    program = compileProgram(vertex_shader_text, fragment_shader_text, vertexName, fragmentName, useCache);
+    GLint success = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if(success)
+    {
+        cacheUniformLocations(program);
+        if(useCache){saveProgramBinary(program, key);}
+    }
+    return program;
+}
 
-    glDeleteShader(vertex);
-    glDeleteShader(fragment);
+static char* readShaderFile(const char* fileName)
+{
+    FILE* shaderSource = fopen(fileName, "rb");
+    if(shaderSource == NULL)
+    {
+        logError(SHADER, "Unable to open shader file : %s\n", fileName);
+        return NULL;
+    }
+    fseek(shaderSource, 0, SEEK_END);
+    size_t TOTAL_SIZE = ftell(shaderSource);
+    rewind(shaderSource);
+
+    char* shader = (char*)malloc(TOTAL_SIZE + 1);
+    if(shader != NULL)
+    {
+        size_t bytes_read = fread(shader, 1, TOTAL_SIZE, shaderSource);
+        shader[bytes_read] = 0;
+    }
+    fclose(shaderSource);
+    return shader;
+}
+
+unsigned int LoadEmbeddedShaders(const char* vertex_shader_text, const char* fragment_shader_text)
+{
+    PROFILE_BEGIN("LoadEmbeddedShaders");
+    unsigned int programID = loadProgram(vertex_shader_text, fragment_shader_text, NULL, NULL);
+    PROFILE_END("LoadEmbeddedShaders");
+    return programID;
+}
+
+unsigned int LoadShaders(const char* vertexPath, const char* fragmentPath)
+{
+    PROFILE_BEGIN("LoadShaders");
+    unsigned int programID = 0;
+    char* vertex = readShaderFile(vertexPath);
+    char* fragment = readShaderFile(fragmentPath);
+    if(vertex && fragment)
+    {
+        programID = loadProgram(vertex, fragment, vertexPath, fragmentPath);
+    }
+    free(vertex);
+    free(fragment);
+    PROFILE_END("LoadShaders");
     return programID;
 }
 
+// Batch compiling. Every shader in the batch is compiled and every program linked before any
+// status is read back, so a driver with KHR_parallel_shader_compile (or its own threads) can
+// work on all of them at once while the caller does other loading.
+typedef struct ShaderBatchEntry
+{
+    char* vertexText;
+    char* fragmentText;
+    GLuint vertex;
+    GLuint fragment;
+    unsigned int program;
+    unsigned long long key;
+    int done;
+} ShaderBatchEntry;
+
+typedef struct ShaderBatch
+{
+    ShaderBatchEntry* entries;
+    int count;
+    int capacity;
+    int pending;
+    int useCache;
+    int parallel;
+} ShaderBatch;
+
+static char* copyShaderText(const char* text)
+{
+    size_t length = strlen(text);
+    char* copy = (char*)malloc(length + 1);
+    if(copy){memcpy(copy, text, length + 1);}
+    return copy;
+}
+
+void InitShaderBatch(ShaderBatch* batch)
+{
+    memset(batch, 0, sizeof(ShaderBatch));
+}
+
+int AddShaderBatch(ShaderBatch* batch, const char* vertex_shader_text, const char* fragment_shader_text)
+{
+    if(batch->count == batch->capacity)
+    {
+        int capacity = batch->capacity ? batch->capacity * 2 : 16;
+        ShaderBatchEntry* entries = (ShaderBatchEntry*)realloc(batch->entries, sizeof(ShaderBatchEntry) * capacity);
+        if(entries == NULL){return -1;}
+        batch->entries = entries;
+        batch->capacity = capacity;
+    }
+    ShaderBatchEntry* entry = &batch->entries[batch->count];
+    memset(entry, 0, sizeof(ShaderBatchEntry));
+    entry->vertexText = copyShaderText(vertex_shader_text);
+    entry->fragmentText = copyShaderText(fragment_shader_text);
+    if(entry->vertexText == NULL || entry->fragmentText == NULL)
+    {
+        free(entry->vertexText);
+        free(entry->fragmentText);
+        return -1;
+    }
+    return batch->count++;
+}
+
+void SubmitShaderBatch(ShaderBatch* batch)
+{
+    batch->useCache = shaderCacheAvailable();
+    batch->parallel = GLAD_GL_KHR_parallel_shader_compile || GLAD_GL_ARB_parallel_shader_compile;
+    if(GLAD_GL_KHR_parallel_shader_compile){glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);}
+    else if(GLAD_GL_ARB_parallel_shader_compile){glMaxShaderCompilerThreadsARB(0xFFFFFFFF);}
+
+    // Cache hits finish right away. Everything else is only submitted here.
+    for(int i = 0; i < batch->count; i++)
+    {
+        ShaderBatchEntry* entry = &batch->entries[i];
+        if(entry->done || entry->program){continue;}
+        if(batch->useCache)
+        {
+            entry->key = shaderCacheKey(entry->vertexText, entry->fragmentText);
+            entry->program = loadProgramBinary(entry->key);
+            if(entry->program)
+            {
+                shaderCacheHits++;
+                cacheUniformLocations(entry->program);
+                entry->done = 1;
+                continue;
+            }
+            shaderCacheMisses++;
+        }
+        const char* vertexText = entry->vertexText;
+        const char* fragmentText = entry->fragmentText;
+        entry->vertex = glCreateShader(GL_VERTEX_SHADER);
+        glShaderSource(entry->vertex, 1, &vertexText, NULL);
+        glCompileShader(entry->vertex);
+        entry->fragment = glCreateShader(GL_FRAGMENT_SHADER);
+        glShaderSource(entry->fragment, 1, &fragmentText, NULL);
+        glCompileShader(entry->fragment);
+    }
+
+    batch->pending = 0;
+    for(int i = 0; i < batch->count; i++)
+    {
+        ShaderBatchEntry* entry = &batch->entries[i];
+        if(entry->done || entry->program){continue;}
+        entry->program = glCreateProgram();
+        glAttachShader(entry->program, entry->vertex);
+        glAttachShader(entry->program, entry->fragment);
+        if(batch->useCache)
+        {
+            glProgramParameteri(entry->program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        }
+        glLinkProgram(entry->program);
+        batch->pending++;
+    }
+}
+
+static void finishShaderBatchEntry(ShaderBatch* batch, ShaderBatchEntry* entry)
+{
+    int success;
+    char infoLog[512];
+
+    glGetShaderiv(entry->vertex, GL_COMPILE_STATUS, &success);
+    if(!success)
+    {
+        glGetShaderInfoLog(entry->vertex, 512, NULL, infoLog);
+        logError(SHADER, "VERTEX - COMPILATION_FAILED\n%s", infoLog);
+    }
+    glGetShaderiv(entry->fragment, GL_COMPILE_STATUS, &success);
+    if(!success)
+    {
+        glGetShaderInfoLog(entry->fragment, 512, NULL, infoLog);
+        logError(SHADER, "FRAGMENT - COMPILATION_FAILED\n%s", infoLog);
+    }
+    glGetProgramiv(entry->program, GL_LINK_STATUS, &success);
+    if(!success)
+    {
+        glGetProgramInfoLog(entry->program, 512, NULL, infoLog);
+        logError(SHADER, "PROGRAM - LINKING_FAILED\n%s", infoLog);
+    } else {
+        cacheUniformLocations(entry->program);
+        if(batch->useCache){saveProgramBinary(entry->program, entry->key);}
+    }
+    glDeleteShader(entry->vertex);
+    glDeleteShader(entry->fragment);
+    entry->vertex = entry->fragment = 0;
+    entry->done = 1;
+    batch->pending--;
+}
+
+int PollShaderBatch(ShaderBatch* batch)
+{
+    for(int i = 0; i < batch->count && batch->pending > 0; i++)
+    {
+        ShaderBatchEntry* entry = &batch->entries[i];
+        if(entry->done){continue;}
+        if(batch->parallel)
+        {
+            GLint complete = GL_FALSE;
+            glGetProgramiv(entry->program, GL_COMPLETION_STATUS_KHR, &complete);
+            if(!complete){continue;}
+        }
+        // Without the extension this is where the driver blocks, one program at a time.
+        finishShaderBatchEntry(batch, entry);
+    }
+    return batch->pending == 0;
+}
+
+void FinishShaderBatch(ShaderBatch* batch)
+{
+    PROFILE_BEGIN("FinishShaderBatch");
+    while(!PollShaderBatch(batch))
+    {
+        // Everything left is still compiling. Ask for the first one and let the driver wait.
+        for(int i = 0; i < batch->count; i++)
+        {
+            if(!batch->entries[i].done)
+            {
+                finishShaderBatchEntry(batch, &batch->entries[i]);
+                break;
+            }
+        }
+    }
+    PROFILE_END("FinishShaderBatch");
+}
+
+unsigned int GetShaderBatchProgram(ShaderBatch* batch, int index)
+{
+    if(index < 0 || index >= batch->count){return 0;}
+    return batch->entries[index].done ? batch->entries[index].program : 0;
+}
+
+void FreeShaderBatch(ShaderBatch* batch)
+{
+    for(int i = 0; i < batch->count; i++)
+    {
+        free(batch->entries[i].vertexText);
+        free(batch->entries[i].fragmentText);
+    }
+    free(batch->entries);
+    memset(batch, 0, sizeof(ShaderBatch));
+}
+
 int loadShaderFromFile(const char* fileName, int shaderType)
 {
 	FILE* shaderSource = fopen(fileName, "rb");
@@ -170,12 +777,12 @@ int loadShaderFromFile(const char* fileName, int shaderType)
             GLsizei logLength;
             GLchar  log[1024];
             glGetShaderInfoLog(shaderID, sizeof(log), &logLength, log);
-            logging("ERROR : %s -->   %s\n", fileName, log);
+            logError(SHADER, "%s -->   %s\n", fileName, log);
         } else {
             return shaderID;
         }
 	} else {
-	    logging("ERROR : Unable to open shader file : %s\n", fileName);
+	    logError(SHADER, "Unable to open shader file : %s\n", fileName);
 	}
     return -1;
 }
@@ -188,13 +795,14 @@ void checkCompileErrors(unsigned int shader)
     if (!success)
     {
         glGetProgramInfoLog(shader, 1024, NULL, infoLog);
-        logging("ERROR : SHADER->PROGRAM - LINKING_FAILED\n%s", infoLog);
+        logError(SHADER, "PROGRAM - LINKING_FAILED\n%s", infoLog);
     }
 }
 
 void ShaderCleanUp(unsigned int programID)
 {
-    glDeleteProgram(programID);
+    forgetUniformLocations(programID);
+    StateDeleteProgram(programID);
 }
 
 #endif // SHADER_H
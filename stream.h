@@ -0,0 +1,174 @@
+/*!
+@author ThatOSDev
+@NOTE
+#define FENCERING_IMPLEMENTATION
+#define STREAM_IMPLEMENTATION
+#include "stream.h"
+
+A ring buffer for geometry that changes every frame. The buffer is split into STREAM_RING_FRAMES
+regions, the CPU writes one while the GPU reads the others, and a fence per region makes sure a
+region is only written again once the GPU is done with it. Nothing here makes the driver wait.
+
+With GL 4.4 or ARB_buffer_storage the buffer is mapped once, persistent and coherent. On GL 3.3
+the frame's region is mapped with GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT, the
+fences already guarantee the GPU is not using it. Define STREAM_NO_BUFFER_STORAGE to force that.
+The buffer and its fences are a FenceRing, see fencering.h.
+
+EXAMPLE :
+    StreamBuffer stream;
+    CreateStreamBuffer(&stream, 1024 * 1024);
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, stream.ring.buffer);   // Attributes at offset 0.
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+    while(...)
+    {
+        BeginStreamFrame(&stream);
+        GLintptr offset;
+        Vertex* v = AllocStream(&stream, count * sizeof(Vertex), sizeof(Vertex), &offset);
+        // fill v
+        FlushStream(&stream);                       // Before any draw that reads it.
+        glDrawArrays(GL_TRIANGLES, (GLint)(offset / sizeof(Vertex)), count);
+        EndStreamFrame(&stream);
+    }
+    DestroyStreamBuffer(&stream);
+*/
+
+#ifndef STREAM_H
+#define STREAM_H
+
+#include <glad/gl.h>
+#include <stddef.h>  // size_t
+#include "fencering.h"
+
+// How many frames the GPU may still be reading while the CPU writes the next one.
+#ifndef STREAM_RING_FRAMES
+#define STREAM_RING_FRAMES 3
+#endif
+
+typedef struct StreamBuffer
+{
+    FenceRing ring;             // ring.persistent is NULL on the GL 3.3 path.
+    unsigned char* mapped;      // GL 3.3 path, the part of the frame region mapped right now.
+    size_t mappedStart;         // Offset of mapped inside the frame region.
+    size_t head;                // Next free byte in the current frame region.
+} StreamBuffer;
+
+/*! @breif
+    This creates the ring.
+	@param[out] The stream buffer.
+	@param[in] The most data written in one frame, in bytes.
+	@return 1 on success, 0 otherwise.
+*/
+int  CreateStreamBuffer(StreamBuffer* stream, size_t bytesPerFrame);
+
+/*! @breif
+    This starts writing a frame. It only waits if the GPU is still STREAM_RING_FRAMES behind.
+	@param[in] The stream buffer.
+*/
+void BeginStreamFrame(StreamBuffer* stream);
+
+/*! @breif
+    This hands out space in the current frame.
+	@param[in] The stream buffer.
+	@param[in] The size in bytes.
+	@param[in] The alignment of the offset, e.g. the vertex size so offset / size is the first vertex.
+	@param[out] The offset in stream->ring.buffer.
+	@return Where to write, NULL if the frame is out of space.
+*/
+void* AllocStream(StreamBuffer* stream, size_t size, size_t alignment, GLintptr* offset);
+
+/*! @breif
+    This makes what was written visible to GL. Call before drawing from it. Free when persistent.
+	@param[in] The stream buffer.
+*/
+void FlushStream(StreamBuffer* stream);
+void EndStreamFrame(StreamBuffer* stream);
+void DestroyStreamBuffer(StreamBuffer* stream);
+
+#endif // STREAM_H
+
+#if defined(STREAM_IMPLEMENTATION) && !defined(STREAM_IMPLEMENTATION_DONE)
+#define STREAM_IMPLEMENTATION_DONE
+
+#include <string.h>  // memset()
+#include "logging.h"
+
+int CreateStreamBuffer(StreamBuffer* stream, size_t bytesPerFrame)
+{
+    memset(stream, 0, sizeof(StreamBuffer));
+#ifdef STREAM_NO_BUFFER_STORAGE
+    int persistent = 0;
+#else
+    int persistent = 1;
+#endif
+    if(!CreateFenceRing(&stream->ring, (bytesPerFrame + 255) & ~(size_t)255, STREAM_RING_FRAMES, persistent, GL_STREAM_DRAW))
+    {
+        logError(GL, "Unable to create a stream buffer");
+        return 0;
+    }
+    return 1;
+}
+
+void BeginStreamFrame(StreamBuffer* stream)
+{
+    WaitFenceRing(&stream->ring);
+    stream->head = 0;
+}
+
+void* AllocStream(StreamBuffer* stream, size_t size, size_t alignment, GLintptr* offset)
+{
+    if(alignment < 1){alignment = 1;}
+    // Aligned in the whole buffer, so offset / alignment is exact in every frame region.
+    FenceRing* ring = &stream->ring;
+    size_t frameStart = ring->frameSize * ring->frame;
+    size_t aligned = (frameStart + stream->head + alignment - 1) / alignment * alignment - frameStart;
+    if(aligned + size > ring->frameSize)
+    {
+        logError(GL, "Stream buffer is out of space this frame");
+        return NULL;
+    }
+    stream->head = aligned + size;
+    *offset = (GLintptr)(frameStart + aligned);
+
+    if(ring->persistent){return ring->persistent + *offset;}
+
+    if(stream->mapped == NULL)
+    {
+        // The fence said the GPU is done with this region, so skip the driver's own checks.
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT;
+        glBindBuffer(GL_COPY_WRITE_BUFFER, ring->buffer);
+        stream->mapped = (unsigned char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, (GLintptr)(frameStart + aligned), (GLsizeiptr)(ring->frameSize - aligned), flags);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        stream->mappedStart = aligned;
+        if(stream->mapped == NULL)
+        {
+            logError(GL, "Unable to map the stream buffer");
+            return NULL;
+        }
+    }
+    return stream->mapped + (aligned - stream->mappedStart);
+}
+
+void FlushStream(StreamBuffer* stream)
+{
+    if(stream->mapped == NULL){return;}
+    glBindBuffer(GL_COPY_WRITE_BUFFER, stream->ring.buffer);
+    glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    stream->mapped = NULL;
+}
+
+void EndStreamFrame(StreamBuffer* stream)
+{
+    FlushStream(stream);
+    AdvanceFenceRing(&stream->ring);
+}
+
+void DestroyStreamBuffer(StreamBuffer* stream)
+{
+    FlushStream(stream);
+    DestroyFenceRing(&stream->ring);
+    memset(stream, 0, sizeof(StreamBuffer));
+}
+
+#endif // STREAM_IMPLEMENTATION
@@ -0,0 +1,276 @@
+/*!
+@author ThatOSDev
+@NOTE
+#define TEXTURE_IMPLEMENTATION
+#include "texture.h"
+
+2D textures from bmp.h. Storage is immutable (glTexStorage2D) with a full mip chain, pixels
+go through a staging PBO, so glTexSubImage2D returns right away and the driver copies in the
+background. LoadTexture decodes the BMP straight into the mapped PBO, there is no extra copy.
+On GL 3.3 without ARB_texture_storage the levels are made with glTexImage2D instead.
+
+GetTextureMemory adds up every live texture including its mips, to keep an eye on the budget.
+Textures can be made from a loader thread with its own shared context (see assets.h).
+
+EXAMPLE :
+    Texture texture;
+    if(LoadTexture(&texture, "stone.bmp"))
+    {
+        StateBindTexture(0, GL_TEXTURE_2D, texture.id);
+        // draw
+        DestroyTexture(&texture);
+    }
+
+    size_t bytes; int count;
+    GetTextureMemory(&bytes, &count);
+*/
+
+#ifndef TEXTURE_H
+#define TEXTURE_H
+
+#include <glad/gl.h>
+#include <stddef.h>  // size_t
+
+typedef struct Texture
+{
+    GLuint id;
+    int width;
+    int height;
+    int levels;
+    GLenum internalFormat;  // GL_RGB8 or GL_RGBA8.
+    size_t bytes;           // GPU memory, all levels.
+} Texture;
+
+/*! @breif
+    This makes a texture from LoadBMP output (RGB or RGBA, bottom row first) and builds the mips.
+	@param[out] The texture.
+	@param[in] The pixels.
+	@param[in] The Width of the image.
+	@param[in] The Height of the image.
+	@param[in] The Bit Depth of the image. 24 or 32.
+	@return 1 on success, 0 otherwise.
+*/
+int  CreateTexture(Texture* texture, const unsigned char* pixels, int width, int height, unsigned short bitDepth);
+
+/*! @breif
+    This loads a 24 or 32 Bit BMP into a texture, decoding right into the staging buffer.
+	@param[out] The texture.
+	@param[in] This is the path and name of the file to load.
+	@return 1 on success, 0 otherwise.
+*/
+int  LoadTexture(Texture* texture, const char* fileName);
+void DestroyTexture(Texture* texture);
+
+/*! @breif
+    This gives the GPU memory of all live textures.
+	@param[out] The bytes, mips included. Can be NULL.
+	@param[out] The number of textures. Can be NULL.
+*/
+void GetTextureMemory(size_t* bytes, int* count);
+
+/*! @breif
+    This deletes the calling thread's staging buffer. Loader threads call it before they let go of their context.
+*/
+void FreeTextureStaging(void);
+
+#endif // TEXTURE_H
+
+#if defined(TEXTURE_IMPLEMENTATION) && !defined(TEXTURE_IMPLEMENTATION_DONE)
+#define TEXTURE_IMPLEMENTATION_DONE
+
+#include <string.h>  // memcpy()  memset()
+#include "bmp.h"
+#include "profiler.h"
+#include "glstate.h"
+#include "logging.h"
+#include "thread.h"
+
+#ifdef _MSC_VER
+#define TEXTURE_THREAD_LOCAL __declspec(thread)
+#else
+#define TEXTURE_THREAD_LOCAL __thread
+#endif
+
+static Atomic64 textureMemory = 0;
+static Atomic64 textureCount = 0;
+
+static int textureLevels(int width, int height)
+{
+    int size = width > height ? width : height;
+    int levels = 1;
+    while(size > 1){size >>= 1; levels++;}
+    return levels;
+}
+
+// Drivers keep RGB8 as 4 bytes a texel, so that is what gets counted.
+static size_t textureBytes(int width, int height, int levels)
+{
+    size_t bytes = 0;
+    for(int i = 0; i < levels; i++)
+    {
+        bytes += (size_t)width * (size_t)height * 4;
+        if(width > 1){width >>= 1;}
+        if(height > 1){height >>= 1;}
+    }
+    return bytes;
+}
+
+static int textureAllocate(Texture* texture, int width, int height, unsigned short bitDepth)
+{
+    memset(texture, 0, sizeof(Texture));
+    if((bitDepth != 24 && bitDepth != 32) || width <= 0 || height <= 0)
+    {
+        logError(GL, "Unable to make a %dx%d texture of %d Bits", width, height, bitDepth);
+        return 0;
+    }
+    texture->width = width;
+    texture->height = height;
+    texture->levels = textureLevels(width, height);
+    texture->internalFormat = (bitDepth == 32) ? GL_RGBA8 : GL_RGB8;
+
+    glGenTextures(1, &texture->id);
+    StateBindTexture(0, GL_TEXTURE_2D, texture->id);
+    if(GLAD_GL_VERSION_4_2 || GLAD_GL_ARB_texture_storage)
+    {
+        glTexStorage2D(GL_TEXTURE_2D, texture->levels, texture->internalFormat, width, height);
+    } else {
+        GLenum format = (bitDepth == 32) ? GL_RGBA : GL_RGB;
+        int w = width, h = height;
+        for(int i = 0; i < texture->levels; i++)
+        {
+            glTexImage2D(GL_TEXTURE_2D, i, (GLint)texture->internalFormat, w, h, 0, format, GL_UNSIGNED_BYTE, NULL);
+            if(w > 1){w >>= 1;}
+            if(h > 1){h >>= 1;}
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, texture->levels - 1);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    return 1;
+}
+
+// The staging PBO is orphaned each time, so mapping never waits on an upload still in flight.
+// It is kept for the life of the context, one per thread so two contexts never share it.
+static TEXTURE_THREAD_LOCAL GLuint textureStaging = 0;
+
+static unsigned char* textureMapStaging(size_t size)
+{
+    if(textureStaging == 0){glGenBuffers(1, &textureStaging);}
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, textureStaging);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)size, NULL, GL_STREAM_DRAW);
+    unsigned char* mapped = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, (GLsizeiptr)size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if(mapped == NULL)
+    {
+        logError(GL, "Unable to map a %zu byte texture staging buffer", size);
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+    return mapped;
+}
+
+void FreeTextureStaging(void)
+{
+    if(textureStaging){StateDeleteBuffers(1, &textureStaging);}
+    textureStaging = 0;
+}
+
+// Copies from the bound staging PBO into level 0, then builds the rest of the chain on the GPU.
+// If the staging buffer was lost the texture is destroyed, it never counts towards the memory.
+static int textureFinishUpload(Texture* texture)
+{
+    if(!glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER))
+    {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        logError(GL, "Texture staging buffer was lost, unable to upload the texture");
+        DestroyTexture(texture);
+        return 0;
+    }
+    GLenum format = (texture->internalFormat == GL_RGBA8) ? GL_RGBA : GL_RGB;
+    GLint alignment = 4;
+    glGetIntegerv(GL_UNPACK_ALIGNMENT, &alignment);
+    StateBindTexture(0, GL_TEXTURE_2D, texture->id);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, texture->width, texture->height, format, GL_UNSIGNED_BYTE, (void*)0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    texture->bytes = textureBytes(texture->width, texture->height, texture->levels);
+    AtomicAdd64(&textureMemory, (long long)texture->bytes);
+    AtomicAdd64(&textureCount, 1);
+    return 1;
+}
+
+int CreateTexture(Texture* texture, const unsigned char* pixels, int width, int height, unsigned short bitDepth)
+{
+    PROFILE_BEGIN("CreateTexture");
+    int ok = 0;
+    if(textureAllocate(texture, width, height, bitDepth))
+    {
+        size_t size = (size_t)width * (size_t)height * (bitDepth / 8);
+        unsigned char* staging = textureMapStaging(size);
+        if(staging)
+        {
+            memcpy(staging, pixels, size);
+            ok = textureFinishUpload(texture);
+        } else {
+            DestroyTexture(texture);
+        }
+    }
+    PROFILE_END("CreateTexture");
+    return ok;
+}
+
+int LoadTexture(Texture* texture, const char* fileName)
+{
+    PROFILE_BEGIN("LoadTexture");
+    int ok = 0;
+    BMPMapping map;
+    // The file is mapped once, the header gives the size and the pixels are swizzled from the mapping.
+    if(!MapBMP(fileName, &map))
+    {
+        memset(texture, 0, sizeof(Texture));
+        logError(BMP, "Unable to load %s as a texture", fileName);
+    } else {
+        if(textureAllocate(texture, map.width, map.height, map.bitDepth))
+        {
+            size_t size = (size_t)map.width * (size_t)map.height * (map.bitDepth / 8);
+            unsigned char* staging = textureMapStaging(size);
+            if(staging && CopyBMPPixels(&map, staging, size))
+            {
+                ok = textureFinishUpload(texture);
+            } else {
+                if(staging)
+                {
+                    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+                    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+                }
+                logError(BMP, "Unable to load %s as a texture", fileName);
+                DestroyTexture(texture);
+            }
+        }
+        UnmapBMP(&map);
+    }
+    PROFILE_END("LoadTexture");
+    return ok;
+}
+
+void DestroyTexture(Texture* texture)
+{
+    if(texture->id){StateDeleteTextures(1, &texture->id);}
+    if(texture->bytes)
+    {
+        AtomicAdd64(&textureMemory, -(long long)texture->bytes);
+        AtomicAdd64(&textureCount, -1);
+    }
+    memset(texture, 0, sizeof(Texture));
+}
+
+void GetTextureMemory(size_t* bytes, int* count)
+{
+    if(bytes){*bytes = (size_t)AtomicLoad64(&textureMemory);}
+    if(count){*count = (int)AtomicLoad64(&textureCount);}
+}
+
+#endif // TEXTURE_IMPLEMENTATION
@@ -0,0 +1,169 @@
+/*!
+@author ThatOSDev
+@NOTE
+Small wrapper over pthreads and Win32 threads. Everything is static inline, so just include it.
+On Linux, link with -lpthread.
+*/
+
+#ifndef THREAD_H
+#define THREAD_H
+
+#ifdef _WIN32
+#include <windows.h> // CreateThread()  CRITICAL_SECTION  CONDITION_VARIABLE  CreateSemaphoreA()
+#else
+#include <pthread.h>   // pthread_create()  pthread_mutex_t  pthread_cond_t
+#include <sched.h>     // sched_yield()
+#include <semaphore.h> // sem_t
+#endif
+
+typedef int (*ThreadFunc)(void* arg);
+
+#ifdef _WIN32
+typedef struct Thread { HANDLE handle; ThreadFunc func; void* arg; } Thread;
+typedef CRITICAL_SECTION Mutex;
+typedef CONDITION_VARIABLE CondVar;
+typedef HANDLE Semaphore;
+#else
+typedef struct Thread { pthread_t handle; ThreadFunc func; void* arg; } Thread;
+typedef pthread_mutex_t Mutex;
+typedef pthread_cond_t CondVar;
+typedef sem_t Semaphore;
+#endif
+
+#ifdef _WIN32
+static DWORD WINAPI threadEntry(LPVOID param)
+{
+    Thread* thread = (Thread*)param;
+    return (DWORD)thread->func(thread->arg);
+}
+#else
+static void* threadEntry(void* param)
+{
+    Thread* thread = (Thread*)param;
+    thread->func(thread->arg);
+    return NULL;
+}
+#endif
+
+/*! @breif
+    This starts a thread. The Thread struct must stay alive until ThreadJoin.
+	@return 1 on success, 0 otherwise.
+*/
+static inline int ThreadStart(Thread* thread, ThreadFunc func, void* arg)
+{
+    thread->func = func;
+    thread->arg = arg;
+#ifdef _WIN32
+    thread->handle = CreateThread(NULL, 0, threadEntry, thread, 0, NULL);
+    return thread->handle != NULL;
+#else
+    return pthread_create(&thread->handle, NULL, threadEntry, thread) == 0;
+#endif
+}
+
+static inline void ThreadJoin(Thread* thread)
+{
+#ifdef _WIN32
+    WaitForSingleObject(thread->handle, INFINITE);
+    CloseHandle(thread->handle);
+#else
+    pthread_join(thread->handle, NULL);
+#endif
+}
+
+static inline void ThreadYield(void)
+{
+#ifdef _WIN32
+    SwitchToThread();
+#else
+    sched_yield();
+#endif
+}
+
+#ifdef _WIN32
+static inline void MutexInit(Mutex* m)    { InitializeCriticalSection(m); }
+static inline void MutexDestroy(Mutex* m) { DeleteCriticalSection(m); }
+static inline void MutexLock(Mutex* m)    { EnterCriticalSection(m); }
+static inline void MutexUnlock(Mutex* m)  { LeaveCriticalSection(m); }
+
+static inline void CondInit(CondVar* c)                { InitializeConditionVariable(c); }
+static inline void CondDestroy(CondVar* c)             { (void)c; }
+static inline void CondWait(CondVar* c, Mutex* m)      { SleepConditionVariableCS(c, m, INFINITE); }
+static inline void CondSignal(CondVar* c)              { WakeConditionVariable(c); }
+static inline void CondBroadcast(CondVar* c)           { WakeAllConditionVariable(c); }
+
+static inline void SemInit(Semaphore* s)               { *s = CreateSemaphoreA(NULL, 0, 0x7fffffff, NULL); }
+static inline void SemDestroy(Semaphore* s)            { CloseHandle(*s); }
+static inline void SemWait(Semaphore* s)               { WaitForSingleObject(*s, INFINITE); }
+static inline void SemPost(Semaphore* s)               { ReleaseSemaphore(*s, 1, NULL); }
+#else
+static inline void MutexInit(Mutex* m)    { pthread_mutex_init(m, NULL); }
+static inline void MutexDestroy(Mutex* m) { pthread_mutex_destroy(m); }
+static inline void MutexLock(Mutex* m)    { pthread_mutex_lock(m); }
+static inline void MutexUnlock(Mutex* m)  { pthread_mutex_unlock(m); }
+
+static inline void CondInit(CondVar* c)                { pthread_cond_init(c, NULL); }
+static inline void CondDestroy(CondVar* c)             { pthread_cond_destroy(c); }
+static inline void CondWait(CondVar* c, Mutex* m)      { pthread_cond_wait(c, m); }
+static inline void CondSignal(CondVar* c)              { pthread_cond_signal(c); }
+static inline void CondBroadcast(CondVar* c)           { pthread_cond_broadcast(c); }
+
+// Starts at 0. Posting never takes a lock, it only enters the kernel when a thread is waiting.
+static inline void SemInit(Semaphore* s)               { sem_init(s, 0, 0); }
+static inline void SemDestroy(Semaphore* s)            { sem_destroy(s); }
+static inline void SemWait(Semaphore* s)               { while(sem_wait(s) != 0){} }
+static inline void SemPost(Semaphore* s)               { sem_post(s); }
+#endif
+
+// A lock that needs no setup, a zeroed SpinLock is unlocked. Only for very short sections.
+typedef volatile long SpinLock;
+
+static inline void SpinLockAcquire(SpinLock* lock)
+{
+#ifdef _WIN32
+    while(InterlockedExchange(lock, 1) != 0)
+    {
+        while(*lock){YieldProcessor();}
+    }
+#else
+    while(__atomic_exchange_n(lock, 1, __ATOMIC_ACQUIRE) != 0)
+    {
+        while(__atomic_load_n(lock, __ATOMIC_RELAXED)){sched_yield();}
+    }
+#endif
+}
+
+static inline void SpinLockRelease(SpinLock* lock)
+{
+#ifdef _WIN32
+    InterlockedExchange(lock, 0);
+#else
+    __atomic_store_n(lock, 0, __ATOMIC_RELEASE);
+#endif
+}
+
+// 64 bit atomics. Loads acquire, stores release, the rest are full barriers.
+typedef volatile long long Atomic64;
+
+#ifdef _WIN32
+static inline long long AtomicLoad64(Atomic64* a)                { return InterlockedCompareExchange64(a, 0, 0); }
+static inline void AtomicStore64(Atomic64* a, long long v)       { InterlockedExchange64(a, v); }
+static inline long long AtomicAdd64(Atomic64* a, long long v)    { return InterlockedExchangeAdd64(a, v); }
+static inline int AtomicCAS64(Atomic64* a, long long* expected, long long desired)
+{
+    long long seen = InterlockedCompareExchange64(a, desired, *expected);
+    if(seen == *expected){return 1;}
+    *expected = seen;
+    return 0;
+}
+#else
+static inline long long AtomicLoad64(Atomic64* a)                { return __atomic_load_n(a, __ATOMIC_ACQUIRE); }
+static inline void AtomicStore64(Atomic64* a, long long v)       { __atomic_store_n(a, v, __ATOMIC_RELEASE); }
+static inline long long AtomicAdd64(Atomic64* a, long long v)    { return __atomic_fetch_add(a, v, __ATOMIC_SEQ_CST); }
+static inline int AtomicCAS64(Atomic64* a, long long* expected, long long desired)
+{
+    return __atomic_compare_exchange_n(a, expected, desired, 0, __ATOMIC_SEQ_CST, __ATOMIC_ACQUIRE);
+}
+#endif
+
+#endif // THREAD_H
@@ -0,0 +1,377 @@
+/*
+ Draws the same small mesh N times a frame without a window and compares ways of submitting it.
+ Build : gcc tools/drawbench.c libs/glad/src/gl.c libs/glad/src/egl.c -I. -Ilibs/glad/include -Ilibs/cglm-master/include -o drawbench -ldl -lpthread -lm
+ Usage : drawbench [frames]        Runs 1000, 10000 and 100000 objects, 100 frames each by default.
+ The queued runs spread the objects over several programs and textures, once drawn as submitted
+ and once through the sorted render queue. The uniform ring run is per-object draws that read
+ their transform and color from a ubo.h ring, one BindUniformRange a draw instead of glUniform.
+*/
+
+#define BMP_IMPLEMENTATION
+#include "bmp.h"
+#include "shader.h"  // This includes GLAD and LOGGING
+#define HEADLESS_IMPLEMENTATION
+#include "headless.h"
+#define PROFILER_IMPLEMENTATION
+#include "profiler.h"
+#define FRAMESTATS_IMPLEMENTATION
+#include "framestats.h"
+#define INSTANCE_IMPLEMENTATION
+#include "instance.h"
+#define BATCH_IMPLEMENTATION
+#include "batch.h"
+#define GLSTATE_IMPLEMENTATION
+#include "glstate.h"
+#define RENDERQUEUE_IMPLEMENTATION
+#include "renderqueue.h"
+#define FENCERING_IMPLEMENTATION
+#define UBO_IMPLEMENTATION
+#include "ubo.h"
+
+#define BENCH_MATERIALS 4  // The multi-draw run splits the objects over this many materials.
+#define BENCH_PROGRAMS  4  // The queued runs use this many programs and textures.
+#define BENCH_TEXTURES  8
+#define BENCH_METHODS   6
+#define BENCH_CAMERA    0  // Uniform block binding points of the uniform ring run.
+#define BENCH_OBJECT    1
+#define BENCH_OBJECT_SIZE 80  // std140 Object block, mat4 + vec4.
+
+const char* perObjectVertex = "#version 330 core\n"
+    "layout (location = 0) in vec3 aPos;\n"
+    "uniform mat4 uTransform;\n"
+    "uniform vec4 uColor;\n"
+    "out vec4 ourColor;\n"
+    "void main()\n"
+    "{\n"
+    "   gl_Position = uTransform * vec4(aPos, 1.0);\n"
+    "   ourColor = uColor;\n"
+    "}\n";
+
+const char* instancedVertex = "#version 330 core\n"
+    "layout (location = 0) in vec3 aPos;\n"
+    "layout (location = 2) in mat4 aTransform;\n"
+    "layout (location = 6) in vec4 aInstanceColor;\n"
+    "out vec4 ourColor;\n"
+    "void main()\n"
+    "{\n"
+    "   gl_Position = aTransform * vec4(aPos, 1.0);\n"
+    "   ourColor = aInstanceColor;\n"
+    "}\n";
+
+const char* uniformBlockVertex = "#version 330 core\n"
+    "layout (location = 0) in vec3 aPos;\n"
+    "layout (std140) uniform Camera { mat4 viewProjection; };\n"
+    "layout (std140) uniform Object { mat4 transform; vec4 color; };\n"
+    "out vec4 ourColor;\n"
+    "void main()\n"
+    "{\n"
+    "   gl_Position = viewProjection * transform * vec4(aPos, 1.0);\n"
+    "   ourColor = color;\n"
+    "}\n";
+
+const char* colorFragment = "#version 330 core\n"
+    "in vec4 ourColor;\n"
+    "out vec4 FragColor;\n"
+    "void main()\n"
+    "{\n"
+    "   FragColor = ourColor;\n"
+    "}\n";
+
+typedef struct Scene
+{
+    int count;
+    mat4* transforms;
+    vec4* colors;
+} Scene;
+
+// A grid of small triangles over the screen, the same every run. They are kept small so the
+// numbers are about submitting draws, not filling pixels.
+static void makeScene(Scene* scene, int count)
+{
+    scene->count = count;
+    scene->transforms = (mat4*)malloc(sizeof(mat4) * (size_t)count);
+    scene->colors = (vec4*)malloc(sizeof(vec4) * (size_t)count);
+    int side = 1;
+    while(side * side < count){side++;}
+    float cell = 2.0f / (float)side;
+    for(int i = 0; i < count; i++)
+    {
+        vec3 position = {-1.0f + cell * ((float)(i % side) + 0.5f), -1.0f + cell * ((float)(i / side) + 0.5f), 0.0f};
+        vec3 scale = {cell * 0.25f, cell * 0.25f, 1.0f};
+        glm_translate_make(scene->transforms[i], position);
+        glm_scale(scene->transforms[i], scale);
+        scene->colors[i][0] = (float)(i % 7) / 6.0f;
+        scene->colors[i][1] = (float)(i % 11) / 10.0f;
+        scene->colors[i][2] = (float)(i % 13) / 12.0f;
+        scene->colors[i][3] = 1.0f;
+    }
+}
+
+static void freeScene(Scene* scene)
+{
+    free(scene->transforms);
+    free(scene->colors);
+}
+
+static void drawPerObject(const Scene* scene, unsigned int program, GLuint vao)
+{
+    int transform = getUniformLocation(program, "uTransform");
+    int color = getUniformLocation(program, "uColor");
+    StateUseProgram(program);
+    for(int i = 0; i < scene->count; i++)
+    {
+        StateBindVertexArray(vao);
+        setMat4Loc(transform, scene->transforms[i]);
+        setVec4Loc(color, scene->colors[i]);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+    }
+}
+
+static void drawInstanced(const Scene* scene, unsigned int program, InstanceBatch* batch)
+{
+    StateUseProgram(program);
+    ClearInstances(batch);
+    for(int i = 0; i < scene->count; i++)
+    {
+        AddInstance(batch, scene->transforms[i], scene->colors[i]);
+    }
+    DrawInstances(batch);
+}
+
+// Every object is its own indirect command, baseInstance picks its transform from perDraw.
+static void drawMultiDraw(const Scene* scene, unsigned int program, DrawBatch* batch, InstanceBatch* perDraw, int mesh)
+{
+    ClearInstances(perDraw);
+    ClearBatchDraws(batch);
+    for(int i = 0; i < scene->count; i++)
+    {
+        AddInstance(perDraw, scene->transforms[i], scene->colors[i]);
+        AddBatchDraw(batch, i % BENCH_MATERIALS, mesh, 1, (GLuint)i);
+    }
+    UploadInstances(perDraw);
+    SubmitDrawBatch(batch);
+    for(int m = 0; m < BENCH_MATERIALS; m++)
+    {
+        StateUseProgram(program);  // Stands in for each material's own program and textures.
+        DrawBatchMaterial(batch, m);
+    }
+}
+
+// The camera is written once a frame and shared by every draw, each object gets its own range.
+static void drawUniformRing(const Scene* scene, unsigned int program, GLuint vao, UniformRing* ring)
+{
+    BeginUniformFrame(ring);
+    GLintptr offset;
+    mat4 viewProjection;
+    glm_mat4_identity(viewProjection);
+    Std140Writer camera = {AllocUniforms(ring, 64, &offset), 0};
+    if(camera.data == NULL){return;}
+    std140Mat4(&camera, viewProjection);
+    BindUniformRange(ring, BENCH_CAMERA, offset, 64);
+
+    StateUseProgram(program);
+    StateBindVertexArray(vao);
+    for(int i = 0; i < scene->count; i++)
+    {
+        Std140Writer object = {AllocUniforms(ring, BENCH_OBJECT_SIZE, &offset), 0};
+        if(object.data == NULL){break;}
+        std140Mat4(&object, scene->transforms[i]);
+        std140Vec4(&object, scene->colors[i]);
+        BindUniformRange(ring, BENCH_OBJECT, offset, BENCH_OBJECT_SIZE);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+    }
+    EndUniformFrame(ring);
+}
+
+static const Scene* queueScene;
+
+static void setupQueueItem(const RenderItem* item)
+{
+    int i = (int)(intptr_t)item->data;
+    setMat4Loc(getUniformLocation(item->program, "uTransform"), queueScene->transforms[i]);
+    setVec4Loc(getUniformLocation(item->program, "uColor"), queueScene->colors[i]);
+}
+
+// Objects pick a program and a texture in no particular order, as they would with many materials.
+static void drawQueued(const Scene* scene, RenderQueue* queue, const unsigned int* programs, const GLuint* textures, GLuint vao, int sorted)
+{
+    queueScene = scene;
+    ClearRenderQueue(queue);
+    unsigned int random = 12345;
+    for(int i = 0; i < scene->count; i++)
+    {
+        random = random * 1103515245u + 12345u;
+        RenderItem item = {0};
+        item.program = programs[(random >> 16) % BENCH_PROGRAMS];
+        item.texture = textures[(random >> 20) % BENCH_TEXTURES];
+        item.vao = vao;
+        item.mode = GL_TRIANGLES;
+        item.count = 3;
+        item.setup = setupQueueItem;
+        item.data = (void*)(intptr_t)i;
+        item.key = MakeRenderKey(0, item.program, item.texture, item.vao, 0.5f);
+        SubmitRenderItem(queue, &item);
+    }
+    if(sorted){SortRenderQueue(queue);}
+    DrawRenderQueue(queue);
+}
+
+static void report(const char* method, int count, FrameStats* stats)
+{
+    unsigned long long frames = stats->cpu.count > 0 ? (unsigned long long)stats->cpu.count : 1;
+    FinishFrameStats(stats);
+    FrameTimeSummary cpu, gpu;
+    SummarizeFrameTimes(&stats->cpu, &cpu);
+    SummarizeFrameTimes(&stats->gpu, &gpu);
+    GLStateStats state;
+    GetStateStats(&state);
+    printf("%-12s %7d objects   CPU mean %9.3f ms  max %9.3f   GPU mean %9.3f ms  max %9.3f   state calls per frame %llu issued %llu skipped\n",
+           method, count, cpu.mean, cpu.max, gpu.mean, gpu.max, state.issued / frames, state.skipped / frames);
+    logInfo(GL, "%s %d objects : CPU mean %.3f ms, GPU mean %.3f ms", method, count, cpu.mean, gpu.mean);
+}
+
+int main(int argc, char** argv)
+{
+    int frames = (argc > 1) ? atoi(argv[1]) : 100;
+    if(frames < 1){frames = 1;}
+    const int counts[] = {1000, 10000, 100000};
+
+    Headless headless;
+    if(!StartHeadless(&headless, 640, 480))
+    {
+        return 1;
+    }
+
+    float vertices[] = {
+         0.5f, -0.5f, 0.0f,
+        -0.5f, -0.5f, 0.0f,
+         0.0f,  0.5f, 0.0f
+    };
+    GLuint vbo, perObjectVAO, instancedVAO;
+    glGenBuffers(1, &vbo);
+    StateBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    glGenVertexArrays(1, &perObjectVAO);
+    glGenVertexArrays(1, &instancedVAO);
+    GLuint vaos[2] = {perObjectVAO, instancedVAO};
+    for(int i = 0; i < 2; i++)
+    {
+        StateBindVertexArray(vaos[i]);
+        StateBindBuffer(GL_ARRAY_BUFFER, vbo);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(0);
+    }
+    StateBindVertexArray(0);
+
+    unsigned int perObjectProgram = LoadEmbeddedShaders(perObjectVertex, colorFragment);
+    unsigned int instancedProgram = LoadEmbeddedShaders(instancedVertex, colorFragment);
+    InstanceBatch batch;
+    if(!perObjectProgram || !instancedProgram || !CreateInstanceBatch(&batch, instancedVAO, GL_TRIANGLES, 3, 0, counts[2]))
+    {
+        StopHeadless(&headless);
+        return 1;
+    }
+
+    const GLuint indices[] = {0, 1, 2};
+    DrawBatch drawBatch;
+    InstanceBatch perDraw;
+    if(!CreateDrawBatch(&drawBatch, GL_TRIANGLES, 3 * sizeof(float), 3, 3, counts[2]))
+    {
+        StopHeadless(&headless);
+        return 1;
+    }
+    StateBindVertexArray(drawBatch.vao);
+    StateBindBuffer(GL_ARRAY_BUFFER, drawBatch.vertexBuffer);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    StateBindVertexArray(0);
+    int triangleMesh = AddBatchMesh(&drawBatch, vertices, 3, indices, 3);
+    if(triangleMesh < 0 || !CreateInstanceBatch(&perDraw, drawBatch.vao, GL_TRIANGLES, 3, 0, counts[2]))
+    {
+        StopHeadless(&headless);
+        return 1;
+    }
+
+    unsigned int queuePrograms[BENCH_PROGRAMS];
+    GLuint queueTextures[BENCH_TEXTURES];
+    for(int i = 0; i < BENCH_PROGRAMS; i++){queuePrograms[i] = LoadEmbeddedShaders(perObjectVertex, colorFragment);}
+    glGenTextures(BENCH_TEXTURES, queueTextures);
+    for(int i = 0; i < BENCH_TEXTURES; i++)
+    {
+        unsigned char texel[4] = {(unsigned char)(i * 32), 128, 255, 255};
+        StateBindTexture(0, GL_TEXTURE_2D, queueTextures[i]);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, texel);
+    }
+    RenderQueue queue;
+    if(!CreateRenderQueue(&queue, counts[2]))
+    {
+        StopHeadless(&headless);
+        return 1;
+    }
+
+    RegisterUniformBlock("Camera", BENCH_CAMERA);
+    RegisterUniformBlock("Object", BENCH_OBJECT);
+    unsigned int uniformBlockProgram = LoadEmbeddedShaders(uniformBlockVertex, colorFragment);
+    BindUniformBlocks(uniformBlockProgram);
+    GLint uniformAlignment = 256;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+    size_t objectStride = (BENCH_OBJECT_SIZE + (size_t)uniformAlignment - 1) / (size_t)uniformAlignment * (size_t)uniformAlignment;
+    UniformRing uniformRing;
+    if(!uniformBlockProgram || !CreateUniformRing(&uniformRing, objectStride * (size_t)(counts[2] + 1)))
+    {
+        StopHeadless(&headless);
+        return 1;
+    }
+
+    glClearColor(0.9f, 0.7f, 0.4f, 1.0f);
+    for(int c = 0; c < 3; c++)
+    {
+        Scene scene;
+        makeScene(&scene, counts[c]);
+        for(int method = 0; method < BENCH_METHODS; method++)
+        {
+            // On the glMultiDrawElements fallback there is no baseInstance, every object would use transform 0.
+            if(method == 2 && !drawBatch.indirect){continue;}
+            FrameStats stats;
+            InitFrameStats(&stats);
+            for(int f = -1; f < frames; f++)  // Frame -1 warms up shaders and buffers, it isn't counted.
+            {
+                if(f == 0){ResetStateStats();}
+                if(f >= 0){BeginFrameStats(&stats);}
+                glClear(GL_COLOR_BUFFER_BIT);
+                if(method == 0)
+                {
+                    drawPerObject(&scene, perObjectProgram, perObjectVAO);
+                } else if(method == 1) {
+                    drawInstanced(&scene, instancedProgram, &batch);
+                } else if(method == 2) {
+                    drawMultiDraw(&scene, instancedProgram, &drawBatch, &perDraw, triangleMesh);
+                } else if(method == 5) {
+                    drawUniformRing(&scene, uniformBlockProgram, perObjectVAO, &uniformRing);
+                } else {
+                    drawQueued(&scene, &queue, queuePrograms, queueTextures, perObjectVAO, method == 4);
+                }
+                if(f >= 0){EndFrameStats(&stats);}
+                glFinish();  // Every frame starts from an idle GPU, whatever the method.
+            }
+            const char* names[BENCH_METHODS] = {"per-object", "instanced", "multi-draw", "as-submitted", "sorted", "uniform-ring"};
+            report(names[method], scene.count, &stats);
+        }
+        freeScene(&scene);
+    }
+
+    DestroyUniformRing(&uniformRing);
+    ShaderCleanUp(uniformBlockProgram);
+    DestroyRenderQueue(&queue);
+    StateDeleteTextures(BENCH_TEXTURES, queueTextures);
+    for(int i = 0; i < BENCH_PROGRAMS; i++){ShaderCleanUp(queuePrograms[i]);}
+    DestroyInstanceBatch(&perDraw);
+    DestroyDrawBatch(&drawBatch);
+    DestroyInstanceBatch(&batch);
+    StateDeleteVertexArrays(2, vaos);
+    StateDeleteBuffers(1, &vbo);
+    ShaderCleanUp(perObjectProgram);
+    ShaderCleanUp(instancedProgram);
+    StopHeadless(&headless);
+    return 0;
+}
@@ -0,0 +1,110 @@
+/*
+ Times GenerateBMP in bmp.h against the old calloc and per-byte loop and prints GB/s.
+ Build : gcc -O2 tools/fillbench.c -I. -o fillbench -lpthread
+ Usage : fillbench [runs]        4K and 8K images at 24 and 32 Bits, best of 20 runs by default.
+ "generate" includes the allocation and first touch of the pages, "fill" writes into a buffer
+ that was already touched, which is FillBMP on its own.
+*/
+
+#define BMP_IMPLEMENTATION
+#include "bmp.h"
+#define PROFILER_NO_GPU
+#define PROFILER_IMPLEMENTATION
+#include "profiler.h"  // ProfileNow()
+
+// The fill loop GenerateBMP had before FillBMP, copied as it was.
+static void legacyFill(unsigned char* data, int totalBytes, int loopBits, unsigned char red, unsigned char green, unsigned char blue, unsigned char alpha)
+{
+    for(int t = 0; t < totalBytes;)
+    {
+        data[t] = red;
+        t++;
+        data[t] = green;
+        t++;
+        data[t] = blue;
+        t++;
+        if(loopBits == 4)
+        {
+            data[t] = alpha;
+            t++;
+        }
+    }
+}
+
+static unsigned char* legacyGenerate(int width, int height, int bits, unsigned char red, unsigned char green, unsigned char blue, unsigned char alpha)
+{
+    int loopBits = (bits / 8);
+    int totalBytes = ((width * height) * loopBits) * sizeof(unsigned char);
+    unsigned char* data = calloc(totalBytes, sizeof(unsigned char));
+    if(data){legacyFill(data, totalBytes, loopBits, red, green, blue, alpha);}
+    return data;
+}
+
+static double rate(size_t totalBytes, long long best)
+{
+    return best > 0 ? (double)totalBytes / (double)best : 0.0;
+}
+
+int main(int argc, char** argv)
+{
+    int runs = (argc > 1) ? atoi(argv[1]) : 20;
+    if(runs < 1){runs = 1;}
+
+    const int sizes[2][2] = {{3840, 2160}, {7680, 4320}};
+    for(int s = 0; s < 2; s++)
+    {
+        for(int bits = 24; bits <= 32; bits += 8)
+        {
+            int width = sizes[s][0], height = sizes[s][1];
+            size_t totalBytes = (size_t)width * height * (bits / 8);
+            long long bestGenerate[2] = {0, 0};
+            long long bestFill[2] = {0, 0};
+            int same = 1;
+
+            unsigned char* check = legacyGenerate(width, height, bits, 10, 20, 30, 40);
+            unsigned char* warm = malloc(totalBytes);
+            if(check == NULL || warm == NULL)
+            {
+                fprintf(stderr, "Out of memory for %dx%d\n", width, height);
+                return 1;
+            }
+            memset(warm, 0, totalBytes);
+
+            for(int r = 0; r < runs; r++)
+            {
+                for(int k = 0; k < 2; k++)
+                {
+                    long long start = ProfileNow();
+                    unsigned char* data = k ? GenerateBMP(width, height, bits, 10, 20, 30, 40) : legacyGenerate(width, height, bits, 10, 20, 30, 40);
+                    long long elapsed = ProfileNow() - start;
+                    if(data == NULL)
+                    {
+                        fprintf(stderr, "Out of memory for %dx%d\n", width, height);
+                        return 1;
+                    }
+                    if(k && r == 0){same = same && (memcmp(data, check, totalBytes) == 0);}
+                    free(data);
+                    if(bestGenerate[k] == 0 || elapsed < bestGenerate[k]){bestGenerate[k] = elapsed;}
+
+                    start = ProfileNow();
+                    if(k)
+                    {
+                        FillBMP(warm, width, height, bits, 10, 20, 30, 40);
+                    } else {
+                        legacyFill(warm, (int)totalBytes, bits / 8, 10, 20, 30, 40);
+                    }
+                    elapsed = ProfileNow() - start;
+                    if(bestFill[k] == 0 || elapsed < bestFill[k]){bestFill[k] = elapsed;}
+                }
+            }
+            same = same && (memcmp(warm, check, totalBytes) == 0);
+
+            printf("%dx%d %d-bit :  generate legacy %.2f GB/s  new %.2f GB/s   fill legacy %.2f GB/s  new %.2f GB/s%s\n",
+                   width, height, bits, rate(totalBytes, bestGenerate[0]), rate(totalBytes, bestGenerate[1]),
+                   rate(totalBytes, bestFill[0]), rate(totalBytes, bestFill[1]), same ? "" : "  (WRONG)");
+            free(check);
+            free(warm);
+        }
+    }
+    return 0;
+}
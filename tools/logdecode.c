@@ -0,0 +1,41 @@
+/*
+ Turns a binary log (loggingStartBinary) back into the text logging() writes.
+ Build : gcc tools/logdecode.c -I. -o logdecode -lpthread
+ Usage : logdecode log-10-17-2026.bin [log-10-17-2026.txt]
+*/
+
+#define LOGGING_IMPLEMENTATION
+#include "logging.h"
+
+int main(int argc, char** argv)
+{
+    if(argc < 2)
+    {
+        fprintf(stderr, "Usage : %s <log.bin> [out.txt]\n", argv[0]);
+        return 1;
+    }
+
+    FILE* in = fopen(argv[1], "rb");
+    if(in == NULL)
+    {
+        fprintf(stderr, "ERROR : Unable to open %s\n", argv[1]);
+        return 1;
+    }
+    FILE* out = (argc > 2) ? fopen(argv[2], "w") : stdout;
+    if(out == NULL)
+    {
+        fprintf(stderr, "ERROR : Unable to create %s\n", argv[2]);
+        fclose(in);
+        return 1;
+    }
+
+    int lines = loggingDecode(in, out);
+    fclose(in);
+    if(out != stdout){fclose(out);}
+    if(lines < 0)
+    {
+        fprintf(stderr, "ERROR : %s is not a binary log, or it is cut short\n", argv[1]);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,266 @@
+/*!
+@author ThatOSDev
+@NOTE
+#define FENCERING_IMPLEMENTATION
+#define UBO_IMPLEMENTATION
+#include "ubo.h"
+
+Uniform buffer objects on top of shader.h. Data that every program shares (camera, lights)
+is written once per frame into a ring buffer and bound by range to a fixed binding point.
+
+EXAMPLE :
+    // GLSL :  layout(std140) uniform Camera { mat4 view; mat4 projection; vec3 eye; };
+    RegisterUniformBlock("Camera", 0);
+    BindUniformBlocks(shaderProgram);              // Once, after linking.
+
+    UniformRing ring;
+    CreateUniformRing(&ring, 64 * 1024);
+    while(...)
+    {
+        BeginUniformFrame(&ring);
+        GLintptr offset;
+        Std140Writer w = {AllocUniforms(&ring, 144, &offset), 0};
+        std140Mat4(&w, view);
+        std140Mat4(&w, projection);
+        std140Vec3(&w, eye);
+        BindUniformRange(&ring, 0, offset, 144);
+        // draw with any program that uses Camera
+        EndUniformFrame(&ring);
+    }
+    DestroyUniformRing(&ring);
+*/
+
+#ifndef UBO_H
+#define UBO_H
+
+#include <glad/gl.h>
+#include <cglm/cglm.h>
+#include <stddef.h>  // size_t
+#include "fencering.h"
+
+// How many frames the GPU may still be reading while the CPU writes the next one.
+#ifndef UBO_RING_FRAMES
+#define UBO_RING_FRAMES 3
+#endif
+
+#ifndef UBO_MAX_BLOCKS
+#define UBO_MAX_BLOCKS 16
+#endif
+
+/*! @breif
+    Writes values at their std140 offsets. data points at the start of the block.
+*/
+typedef struct Std140Writer
+{
+    unsigned char* data;
+    size_t offset;
+} Std140Writer;
+
+void std140Int(Std140Writer* w, int value);
+void std140Float(Std140Writer* w, float value);
+void std140Vec2(Std140Writer* w, const vec2 value);
+void std140Vec3(Std140Writer* w, const vec3 value);  // Aligned to 16, the next float packs into the gap.
+void std140Vec4(Std140Writer* w, const vec4 value);
+void std140Mat3(Std140Writer* w, const mat3 value);  // 3 columns, each padded to a vec4.
+void std140Mat4(Std140Writer* w, const mat4 value);
+void std140Pad(Std140Writer* w, size_t alignment);   // Align the next member, e.g. 16 after an array or struct.
+
+typedef struct UniformRing
+{
+    FenceRing ring;            // ring.persistent is NULL when falling back to glBufferSubData.
+    unsigned char* shadow;     // CPU copy for the fallback path.
+    size_t head;               // Next free byte in the current frame region.
+    size_t dirtyStart;         // Fallback only, bytes written but not uploaded yet.
+    size_t dirtyEnd;
+    GLint alignment;
+} UniformRing;
+
+/*! @breif
+    This remembers that a named uniform block always uses a binding point.
+	@param[in] The block name as written in GLSL.
+	@param[in] The binding point.
+*/
+void RegisterUniformBlock(const char* name, unsigned int binding);
+
+/*! @breif
+    This points every registered block the program uses at its binding point. Call after linking.
+	@param[in] The program.
+*/
+void BindUniformBlocks(unsigned int programID);
+
+/*! @breif
+    This creates the ring. It is persistently mapped with glBufferStorage when GL 4.4 or
+    ARB_buffer_storage is there, otherwise uploads go through glBufferSubData.
+	@param[out] The ring.
+	@param[in] The most uniform data written in one frame, in bytes.
+	@return 1 on success, 0 otherwise.
+*/
+int  CreateUniformRing(UniformRing* ring, size_t bytesPerFrame);
+void BeginUniformFrame(UniformRing* ring);
+
+/*! @breif
+    This hands out space for one block in the current frame, aligned for glBindBufferRange.
+	@param[in] The ring.
+	@param[in] The size of the block in bytes.
+	@param[out] The offset to pass to BindUniformRange.
+	@return Where to write the block, NULL if the frame is out of space.
+*/
+void* AllocUniforms(UniformRing* ring, size_t size, GLintptr* offset);
+void BindUniformRange(UniformRing* ring, unsigned int binding, GLintptr offset, size_t size);
+void EndUniformFrame(UniformRing* ring);
+void DestroyUniformRing(UniformRing* ring);
+
+#endif // UBO_H
+
+#if defined(UBO_IMPLEMENTATION) && !defined(UBO_IMPLEMENTATION_DONE)
+#define UBO_IMPLEMENTATION_DONE
+
+#include <stdlib.h>  // malloc()  free()
+#include <string.h>  // memcpy()  memset()  strncpy()
+#include "logging.h"
+
+static void std140Put(Std140Writer* w, size_t alignment, const void* value, size_t size)
+{
+    w->offset = (w->offset + alignment - 1) & ~(alignment - 1);
+    memcpy(w->data + w->offset, value, size);
+    w->offset += size;
+}
+
+void std140Int(Std140Writer* w, int value)            { std140Put(w, 4, &value, 4); }
+void std140Float(Std140Writer* w, float value)        { std140Put(w, 4, &value, 4); }
+void std140Vec2(Std140Writer* w, const vec2 value)    { std140Put(w, 8, value, 8); }
+void std140Vec3(Std140Writer* w, const vec3 value)    { std140Put(w, 16, value, 12); }
+void std140Vec4(Std140Writer* w, const vec4 value)    { std140Put(w, 16, value, 16); }
+void std140Mat4(Std140Writer* w, const mat4 value)    { std140Put(w, 16, value, 64); }
+
+void std140Mat3(Std140Writer* w, const mat3 value)
+{
+    for(int c = 0; c < 3; c++)
+    {
+        std140Put(w, 16, value[c], 12);
+        w->offset += 4;
+    }
+}
+
+void std140Pad(Std140Writer* w, size_t alignment)
+{
+    w->offset = (w->offset + alignment - 1) & ~(alignment - 1);
+}
+
+typedef struct UniformBlockBinding
+{
+    char name[64];
+    unsigned int binding;
+} UniformBlockBinding;
+
+static UniformBlockBinding uniformBlocks[UBO_MAX_BLOCKS];
+static int uniformBlockCount = 0;
+
+void RegisterUniformBlock(const char* name, unsigned int binding)
+{
+    for(int i = 0; i < uniformBlockCount; i++)
+    {
+        if(strcmp(uniformBlocks[i].name, name) == 0)
+        {
+            uniformBlocks[i].binding = binding;
+            return;
+        }
+    }
+    if(uniformBlockCount >= UBO_MAX_BLOCKS)
+    {
+        logError(GL, "Too many uniform blocks, raise UBO_MAX_BLOCKS");
+        return;
+    }
+    strncpy(uniformBlocks[uniformBlockCount].name, name, sizeof(uniformBlocks[0].name) - 1);
+    uniformBlocks[uniformBlockCount].binding = binding;
+    uniformBlockCount++;
+}
+
+void BindUniformBlocks(unsigned int programID)
+{
+    for(int i = 0; i < uniformBlockCount; i++)
+    {
+        GLuint index = glGetUniformBlockIndex(programID, uniformBlocks[i].name);
+        if(index != GL_INVALID_INDEX)
+        {
+            glUniformBlockBinding(programID, index, uniformBlocks[i].binding);
+        }
+    }
+}
+
+int CreateUniformRing(UniformRing* ring, size_t bytesPerFrame)
+{
+    memset(ring, 0, sizeof(UniformRing));
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &ring->alignment);
+    if(ring->alignment < 1){ring->alignment = 256;}
+
+    size_t frameSize = (bytesPerFrame + ring->alignment - 1) & ~((size_t)ring->alignment - 1);
+    if(!CreateFenceRing(&ring->ring, frameSize, UBO_RING_FRAMES, 1, GL_DYNAMIC_DRAW))
+    {
+        logError(GL, "Unable to create the uniform ring");
+        return 0;
+    }
+    if(ring->ring.persistent == NULL)
+    {
+        ring->shadow = malloc(frameSize * UBO_RING_FRAMES);
+        if(ring->shadow == NULL)
+        {
+            logError(GL, "Unable to allocate the uniform ring");
+            DestroyUniformRing(ring);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+void BeginUniformFrame(UniformRing* ring)
+{
+    // Three frames back this region was handed to the GPU. Normally it finished long ago.
+    WaitFenceRing(&ring->ring);
+    ring->head = 0;
+    ring->dirtyStart = ring->dirtyEnd = 0;
+}
+
+void* AllocUniforms(UniformRing* ring, size_t size, GLintptr* offset)
+{
+    size_t aligned = (ring->head + ring->alignment - 1) & ~((size_t)ring->alignment - 1);
+    if(aligned + size > ring->ring.frameSize)
+    {
+        logError(GL, "Uniform ring is out of space this frame");
+        return NULL;
+    }
+    ring->head = aligned + size;
+    *offset = (GLintptr)(ring->ring.frameSize * ring->ring.frame + aligned);
+
+    if(ring->ring.persistent){return ring->ring.persistent + *offset;}
+
+    if(ring->dirtyStart == ring->dirtyEnd){ring->dirtyStart = (size_t)*offset;}
+    ring->dirtyEnd = (size_t)*offset + size;
+    return ring->shadow + *offset;
+}
+
+void BindUniformRange(UniformRing* ring, unsigned int binding, GLintptr offset, size_t size)
+{
+    if(ring->ring.persistent == NULL && ring->dirtyEnd > ring->dirtyStart)
+    {
+        // Fallback : upload everything written since the last bind in one call.
+        glBindBuffer(GL_UNIFORM_BUFFER, ring->ring.buffer);
+        glBufferSubData(GL_UNIFORM_BUFFER, (GLintptr)ring->dirtyStart, (GLsizeiptr)(ring->dirtyEnd - ring->dirtyStart), ring->shadow + ring->dirtyStart);
+        ring->dirtyStart = ring->dirtyEnd;
+    }
+    glBindBufferRange(GL_UNIFORM_BUFFER, binding, ring->ring.buffer, offset, (GLsizeiptr)size);
+}
+
+void EndUniformFrame(UniformRing* ring)
+{
+    AdvanceFenceRing(&ring->ring);
+}
+
+void DestroyUniformRing(UniformRing* ring)
+{
+    DestroyFenceRing(&ring->ring);
+    free(ring->shadow);
+    memset(ring, 0, sizeof(UniformRing));
+}
+
+#endif // UBO_IMPLEMENTATION